@@ -0,0 +1,318 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Allocation tracking scopes
+================================
+
+Introduction:
+
+	Getting rid of heap allocations on a hot path starts with knowing where
+	they come from. An allocation scope counts the allocations, the bytes
+	allocated and the peak of live bytes made by the current thread while it
+	is active, and adds them to totals kept per call site:
+
+		void handle(const request& r)
+		{
+			BOOST_ALLOCATION_TRACKING_SCOPE(canary, "handle");
+			...
+		}
+
+		boost::allocation_tracking::dump(std::cerr);
+
+	The counting is done by replacements of the global operator new and
+	delete that check a thread-local flag first; while no scope is active on
+	the thread they cost one extra load and branch over malloc and free. The
+	scope itself is predicated, so production canaries can enable it for a
+	fraction of the requests.
+
+	The replacement operators have to be defined in exactly one translation
+	unit of the program:
+
+		// allocation_hooks.cpp
+		#include "allocation_tracking.hpp"
+		BOOST_ALLOCATION_TRACKING_DEFINE_HOOKS()
+
+Synopsis:
+
+	class allocation_site
+		: public site_registry::registered_site<allocation_site>
+	{
+		allocation_site(const char* name, const char* file, int line);
+
+		uint64_t scopes() const;
+		uint64_t allocations() const;
+		uint64_t bytes() const;
+		uint64_t peak_live_bytes() const;  // largest peak of a single scope
+	};
+
+	class allocation_scope
+	{
+		explicit allocation_scope(allocation_site& site);
+	};
+
+	void dump(std::ostream& os);     // sorted by allocation count
+
+	BOOST_ALLOCATION_TRACKING_SCOPE(condition, name)
+	BOOST_ALLOCATION_TRACKING_DEFINE_HOOKS()
+
+Notes:
+
+	* sizes are the usable sizes reported by the C library
+	(malloc_usable_size, _msize), so they include allocator rounding and
+	frees are accounted exactly without a size header.
+
+	* scopes nest; an inner scope's allocations count towards the outer one
+	as well.
+
+	* only allocations through the replaceable global operator new are
+	seen; malloc, allocators with their own arenas and over-aligned new
+	(C++17) are not.
+
+	* the replacement operator new throws std::bad_alloc straight away when
+	malloc fails; std::new_handler is not consulted.
+
+	* memory freed inside a scope but allocated before it reduces the live
+	byte count below the scope's starting point; the peak is never
+	negative.
+
+*/
+
+#include "predicated_construction.hpp"
+#include "site_registry.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <ostream>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#define BOOST_ALLOCATION_TRACKING_USABLE_SIZE(p) _msize(p)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define BOOST_ALLOCATION_TRACKING_USABLE_SIZE(p) malloc_size(p)
+#else
+#include <malloc.h>
+#define BOOST_ALLOCATION_TRACKING_USABLE_SIZE(p) malloc_usable_size(p)
+#endif
+
+namespace boost {
+namespace allocation_tracking {
+
+class allocation_site;
+
+namespace detail {
+
+// Plain data so that it's constant-initialized: operator new may run before
+// any dynamic initialization of the thread has happened.
+struct thread_counters
+{
+	unsigned depth;
+	uint64_t allocations;
+	uint64_t bytes;
+	int64_t live;
+	int64_t peak;
+};
+
+inline thread_counters& counters()
+{
+	static thread_local thread_counters c = { 0, 0, 0, 0, 0 };
+	return c;
+}
+
+inline void* allocate(std::size_t size)
+{
+	void* p = std::malloc(size ? size : 1);
+	if (p)
+	{
+		thread_counters& c = counters();
+		if (c.depth)
+		{
+			const std::size_t n = BOOST_ALLOCATION_TRACKING_USABLE_SIZE(p);
+			++c.allocations;
+			c.bytes += n;
+			c.live += int64_t(n);
+			if (c.live > c.peak)
+				c.peak = c.live;
+		}
+	}
+	return p;
+}
+
+// GCC sees the malloc in allocate() and the free here through the inlined
+// replacement operators and mistakes them for a new/free mismatch.
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+inline void deallocate(void* p)
+{
+	if (!p)
+		return;
+	thread_counters& c = counters();
+	if (c.depth)
+		c.live -= int64_t(BOOST_ALLOCATION_TRACKING_USABLE_SIZE(p));
+	std::free(p);
+}
+
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+}
+
+class allocation_site
+	: public site_registry::registered_site<allocation_site>
+{
+public:
+	allocation_site(const char* name, const char* file, int line)
+		: registered_site<allocation_site>(name, file, line)
+		, _scopes(0), _allocations(0), _bytes(0), _peak(0)
+	{
+		enlist();
+	}
+
+	uint64_t scopes() const { return _scopes.load(std::memory_order_relaxed); }
+	uint64_t allocations() const { return _allocations.load(std::memory_order_relaxed); }
+	uint64_t bytes() const { return _bytes.load(std::memory_order_relaxed); }
+	uint64_t peak_live_bytes() const { return _peak.load(std::memory_order_relaxed); }
+
+	void add(uint64_t allocations, uint64_t bytes, uint64_t peak)
+	{
+		_scopes.fetch_add(1, std::memory_order_relaxed);
+		_allocations.fetch_add(allocations, std::memory_order_relaxed);
+		_bytes.fetch_add(bytes, std::memory_order_relaxed);
+		uint64_t current = _peak.load(std::memory_order_relaxed);
+		while (current < peak && !_peak.compare_exchange_weak(current, peak, std::memory_order_relaxed))
+			;
+	}
+
+	struct snapshot
+	{
+		explicit snapshot(const allocation_site& s)
+			: site(&s), scopes(s.scopes()), allocations(s.allocations())
+			, bytes(s.bytes()), peak(s.peak_live_bytes())
+		{}
+
+		const allocation_site* site;
+		uint64_t scopes;
+		uint64_t allocations;
+		uint64_t bytes;
+		uint64_t peak;
+	};
+
+private:
+	std::atomic<uint64_t> _scopes;
+	std::atomic<uint64_t> _allocations;
+	std::atomic<uint64_t> _bytes;
+	std::atomic<uint64_t> _peak;
+};
+
+class allocation_scope
+	: noncopyable
+{
+public:
+	explicit allocation_scope(allocation_site& site)
+		: _site(site)
+	{
+		detail::thread_counters& c = detail::counters();
+		_allocations = c.allocations;
+		_bytes = c.bytes;
+		_live = c.live;
+		_outer_peak = c.peak;
+		c.peak = c.live;
+		++c.depth;
+	}
+
+	~allocation_scope()
+	{
+		detail::thread_counters& c = detail::counters();
+		--c.depth;
+		const int64_t peak = c.peak - _live;
+		_site.add(c.allocations - _allocations, c.bytes - _bytes, peak > 0 ? uint64_t(peak) : 0);
+		if (_outer_peak > c.peak)
+			c.peak = _outer_peak;
+	}
+
+private:
+	allocation_site& _site;
+	uint64_t _allocations;
+	uint64_t _bytes;
+	int64_t _live;
+	int64_t _outer_peak;
+};
+
+inline void dump(std::ostream& os)
+{
+	std::vector<allocation_site::snapshot> sites = site_registry::snapshots<allocation_site>(&allocation_site::snapshot::scopes);
+	site_registry::sort_descending(sites, &allocation_site::snapshot::allocations);
+	for (std::size_t i = 0; i < sites.size(); ++i)
+	{
+		const allocation_site::snapshot& s = sites[i];
+		site_registry::write_location(os, *s.site) << "scopes=" << s.scopes
+			<< " allocations=" << s.allocations
+			<< " (" << double(s.allocations) / double(s.scopes) << "/scope)"
+			<< " bytes=" << s.bytes
+			<< " peak_live_bytes=" << s.peak << '\n';
+	}
+}
+
+}
+}
+
+#define BOOST_ALLOCATION_TRACKING_SCOPE(condition, name) \
+	BOOST_REGISTERED_SITE_SCOPE(condition, ::boost::allocation_tracking::allocation_site, ::boost::allocation_tracking::allocation_scope, boost_allocation_scope, name)
+
+#define BOOST_ALLOCATION_TRACKING_DEFINE_HOOKS() \
+	void* operator new(std::size_t size) \
+	{ \
+		if (void* p = ::boost::allocation_tracking::detail::allocate(size)) \
+			return p; \
+		throw std::bad_alloc(); \
+	} \
+	void* operator new[](std::size_t size) \
+	{ \
+		return ::operator new(size); \
+	} \
+	void* operator new(std::size_t size, const std::nothrow_t&) noexcept \
+	{ \
+		return ::boost::allocation_tracking::detail::allocate(size); \
+	} \
+	void* operator new[](std::size_t size, const std::nothrow_t&) noexcept \
+	{ \
+		return ::boost::allocation_tracking::detail::allocate(size); \
+	} \
+	void operator delete(void* p) noexcept \
+	{ \
+		::boost::allocation_tracking::detail::deallocate(p); \
+	} \
+	void operator delete[](void* p) noexcept \
+	{ \
+		::boost::allocation_tracking::detail::deallocate(p); \
+	} \
+	void operator delete(void* p, std::size_t) noexcept \
+	{ \
+		::boost::allocation_tracking::detail::deallocate(p); \
+	} \
+	void operator delete[](void* p, std::size_t) noexcept \
+	{ \
+		::boost::allocation_tracking::detail::deallocate(p); \
+	} \
+	void operator delete(void* p, const std::nothrow_t&) noexcept \
+	{ \
+		::boost::allocation_tracking::detail::deallocate(p); \
+	} \
+	void operator delete[](void* p, const std::nothrow_t&) noexcept \
+	{ \
+		::boost::allocation_tracking::detail::deallocate(p); \
+	}
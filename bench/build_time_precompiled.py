@@ -0,0 +1,77 @@
+#  Distributed under the Boost
+#  Software License, Version 1.0. (See accompanying file
+#  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+# Build time of a translation unit using custom_ops.hpp and
+# predicated_construction.hpp, included textually, through precompiled.hpp
+# as a precompiled header and through C++20 header units (GCC 11 and later):
+#
+#	python3 bench/build_time_precompiled.py [--cxx g++] [--repeat 5]
+#
+# The precompiled header and the header units are built once up front and
+# aren't counted; the best of --repeat compilations of precompiled_usage.cpp
+# (precompiled_usage_modules.cpp for header units) is reported for each. All
+# three use the same -std so that the precompiled header is valid for the
+# translation unit.
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+BENCH = os.path.abspath(os.path.dirname(__file__))
+ROOT = os.path.dirname(BENCH)
+SOURCE = os.path.join(BENCH, 'precompiled_usage.cpp')
+MODULES_SOURCE = os.path.join(BENCH, 'precompiled_usage_modules.cpp')
+
+
+def run(cxx, args, cwd):
+	start = time.perf_counter()
+	subprocess.run([cxx] + args, cwd=cwd, check=True)
+	return time.perf_counter() - start
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Build time with precompiled headers and header units.')
+	parser.add_argument('--cxx', default=os.environ.get('CXX', 'g++'))
+	parser.add_argument('--flags', default='-std=c++20 -fsyntax-only', help='compiler flags, one string')
+	parser.add_argument('--repeat', type=int, default=5, help='compilations per variant; the best is reported')
+	args = parser.parse_args()
+
+	flags = args.flags.split()
+	work = tempfile.mkdtemp()
+	try:
+		variants = [('textual', SOURCE, ['-I' + ROOT])]
+
+		# A wrapper precompiled.hpp that includes the real one is precompiled,
+		# as CMake does, and found ahead of it in the include path.
+		pch = os.path.join(work, 'pch')
+		os.mkdir(pch)
+		header = os.path.join(pch, 'precompiled.hpp')
+		with open(header, 'w') as f:
+			f.write('#include "%s"\n' % os.path.join(ROOT, 'precompiled.hpp'))
+		run(args.cxx, [f for f in flags if f != '-fsyntax-only'] + ['-I' + ROOT, '-x', 'c++-header', header, '-o', header + '.gch'], work)
+		variants.append(('pch', SOURCE, ['-I' + pch, '-I' + ROOT]))
+
+		units = ['-fmodules-ts', '-I' + ROOT]
+		try:
+			for name in ('custom_ops.hpp', 'predicated_construction.hpp'):
+				run(args.cxx, [f for f in flags if f != '-fsyntax-only'] + units + ['-fmodule-header', '-x', 'c++-header', os.path.join(ROOT, name)], work)
+			variants.append(('header units', MODULES_SOURCE, units))
+		except subprocess.CalledProcessError:
+			print('header units: not supported by %s' % args.cxx)
+
+		print('%s %s' % (args.cxx, args.flags))
+		for name, source, extra in variants:
+			best = min(run(args.cxx, flags + extra + ['-c', source, '-o', os.devnull], work) for _ in range(args.repeat))
+			print('%-14s %8.0f ms' % (name, 1000 * best))
+	finally:
+		shutil.rmtree(work)
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
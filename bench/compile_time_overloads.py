@@ -0,0 +1,94 @@
+#  Distributed under the Boost
+#  Software License, Version 1.0. (See accompanying file
+#  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+# Compile time of custom operators depending on where they are declared.
+#
+# Generates one translation unit per registration style - BOOST_CUSTOM_OP at
+# global scope, BOOST_CUSTOM_OP in the right-hand type's namespace and
+# BOOST_CUSTOM_OP_FRIEND inside the right-hand class - each with --ops
+# custom operators and a function applying the unary - and ~ of an unrelated
+# type --uses times each, then reports the best of --repeat compilations:
+#
+#	python3 bench/compile_time_overloads.py [--cxx g++] [--ops 300] [--uses 3000]
+#
+# Only the front end is timed by default (-fsyntax-only); that's where the
+# overload resolution happens. Pass --flags to time full compilations.
+#
+# With --keep DIR the generated sources are written to DIR and left there.
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+HEADER = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', 'custom_ops.hpp'))
+
+STYLES = ('global', 'namespace', 'friend')
+
+
+def generate(style, ops, uses):
+	lines = ['#include "%s"' % HEADER, 'struct A { int a; };', 'namespace ops {']
+	for i in range(ops):
+		if style == 'friend':
+			lines.append('struct B%d { int b; BOOST_CUSTOM_OP_FRIEND(int, const A&, a, /, ~, -, const B%d&, b) { return a.a + b.b; } };' % (i, i))
+		else:
+			lines.append('struct B%d { int b; };' % i)
+			if style == 'namespace':
+				lines.append('BOOST_CUSTOM_OP(int, const A&, a, /, ~, -, const B%d&, b) { return a.a + b.b; }' % i)
+	lines.append('}')
+	if style == 'global':
+		for i in range(ops):
+			lines.append('BOOST_CUSTOM_OP(int, const A&, a, /, ~, -, const ops::B%d&, b) { return a.a + b.b; }' % i)
+	# The unrelated type whose operators every custom operator competes with
+	# at global scope.
+	lines.append('struct V { int v; };')
+	lines.append('inline V operator-(V x) { x.v = -x.v; return x; }')
+	lines.append('inline V operator~(V x) { x.v = ~x.v; return x; }')
+	lines.append('int use(V x, const A& a, const ops::B0& b)')
+	lines.append('{')
+	lines.append('\tint s = 0;')
+	lines.extend(['\ts += (-x).v + (~x).v;'] * uses)
+	lines.append('\treturn s + (a /~- b);')
+	lines.append('}')
+	return '\n'.join(lines) + '\n'
+
+
+def compile_time(cxx, flags, source):
+	start = time.perf_counter()
+	subprocess.run([cxx] + flags + ['-c', source, '-o', os.devnull], check=True)
+	return time.perf_counter() - start
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Compile time of custom operators by registration style.')
+	parser.add_argument('--cxx', default=os.environ.get('CXX', 'g++'))
+	parser.add_argument('--flags', default='-std=c++11 -fsyntax-only', help='compiler flags, one string')
+	parser.add_argument('--ops', type=int, default=300, help='custom operators per translation unit')
+	parser.add_argument('--uses', type=int, default=3000, help='applications of each unrelated unary operator')
+	parser.add_argument('--repeat', type=int, default=3, help='compilations per style; the best is reported')
+	parser.add_argument('--keep', metavar='DIR', help='write the generated sources to DIR and keep them')
+	args = parser.parse_args()
+
+	directory = args.keep or tempfile.mkdtemp()
+	os.makedirs(directory, exist_ok=True)
+	flags = args.flags.split() + ['-I' + os.path.dirname(HEADER)]
+	try:
+		print('%d custom operators, %d unrelated unary operator uses, %s %s' % (args.ops, 2 * args.uses, args.cxx, args.flags))
+		for style in STYLES:
+			source = os.path.join(directory, style + '.cpp')
+			with open(source, 'w') as f:
+				f.write(generate(style, args.ops, args.uses))
+			best = min(compile_time(args.cxx, flags, source) for _ in range(args.repeat))
+			print('%-10s %8.2f s' % (style, best))
+	finally:
+		if not args.keep:
+			shutil.rmtree(directory)
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
@@ -0,0 +1,54 @@
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// A translation unit using both custom_ops.hpp and predicated_construction.hpp,
+// built three ways by CMakeLists.txt and timed by build_time_precompiled.py:
+// textually, through the precompiled header and - included by
+// precompiled_usage_modules.cpp after importing them - through header units.
+
+#if !defined(BOOST_BENCH_HEADER_UNITS)
+#include "precompiled.hpp"
+#endif
+
+#include <cstdio>
+
+namespace {
+
+struct A
+{
+	int a;
+};
+
+struct B
+{
+	int b;
+};
+
+BOOST_CUSTOM_OP(int, const A&, a, /, ~+, -, const B&, b)
+{
+	return a.a * 2 + b.b * 3;
+}
+
+struct sentry
+{
+	explicit sentry(int value)
+	{
+		std::printf("enter %d\n", value);
+	}
+
+	~sentry()
+	{
+		std::printf("leave\n");
+	}
+};
+
+}
+
+int main(int argc, char**)
+{
+	const A a = { argc };
+	const B b = { 7 };
+	BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(argc > 0, sentry, (a /~+- b));
+	return 0;
+}
@@ -0,0 +1,12 @@
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// precompiled_usage.cpp with custom_ops.hpp and predicated_construction.hpp
+// imported as C++20 header units instead of included.
+
+import "custom_ops.hpp";
+import "predicated_construction.hpp";
+
+#define BOOST_BENCH_HEADER_UNITS
+#include "precompiled_usage.cpp"
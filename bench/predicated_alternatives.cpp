@@ -0,0 +1,121 @@
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// The same conditional sentry written five ways - the alternatives listed in
+// predicated_construction.hpp. Kept in a translation unit of their own so the
+// scopes aren't inlined into the timing loop and -fstack-usage reports each
+// of them separately (see predicated_alternatives_size.py).
+
+#include "predicated_alternatives.hpp"
+
+#include "predicated_construction.hpp"
+
+#include <memory>
+#include <optional>
+
+namespace {
+
+volatile int state;
+
+struct sentry
+{
+	explicit sentry(int value)
+		: _saved(state)
+	{
+		state = value;
+	}
+
+	~sentry()
+	{
+		state = _saved;
+	}
+
+private:
+	int _saved;
+};
+
+// The sentry modified to take the predicate as a constructor parameter.
+struct flag_sentry
+{
+	flag_sentry(int value, bool enable)
+		: _saved(0), _enabled(enable)
+	{
+		if (_enabled)
+		{
+			_saved = state;
+			state = value;
+		}
+	}
+
+	~flag_sentry()
+	{
+		if (_enabled)
+			state = _saved;
+	}
+
+private:
+	int _saved;
+	bool _enabled;
+};
+
+#if defined(__GNUC__)
+__attribute__((noinline))
+#elif defined(_MSC_VER)
+__declspec(noinline)
+#endif
+void work(int& acc)
+{
+	acc += state;
+}
+
+}
+
+extern "C" int alternative_predicated(bool condition, int value)
+{
+	int acc = 0;
+	BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(condition, sentry, (value));
+	work(acc);
+	return acc;
+}
+
+extern "C" int alternative_optional(bool condition, int value)
+{
+	int acc = 0;
+	std::optional<sentry> s;
+	if (condition)
+		s.emplace(value);
+	work(acc);
+	return acc;
+}
+
+extern "C" int alternative_unique_ptr(bool condition, int value)
+{
+	int acc = 0;
+	std::unique_ptr<sentry> s;
+	if (condition)
+		s.reset(new sentry(value));
+	work(acc);
+	return acc;
+}
+
+extern "C" int alternative_flag(bool condition, int value)
+{
+	int acc = 0;
+	flag_sentry s(value, condition);
+	work(acc);
+	return acc;
+}
+
+extern "C" int alternative_duplicated(bool condition, int value)
+{
+	int acc = 0;
+	if (condition)
+	{
+		sentry s(value);
+		work(acc);
+	}
+	else
+		work(acc);
+	return acc;
+}
@@ -0,0 +1,14 @@
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// The variants defined in predicated_alternatives.cpp. Each constructs a
+// sentry around a call that can't be inlined if 'condition' is true.
+
+#pragma once
+
+extern "C" int alternative_predicated(bool condition, int value);      // BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR
+extern "C" int alternative_optional(bool condition, int value);        // std::optional::emplace
+extern "C" int alternative_unique_ptr(bool condition, int value);      // std::unique_ptr and new
+extern "C" int alternative_flag(bool condition, int value);            // 'bool enable' constructor parameter
+extern "C" int alternative_duplicated(bool condition, int value);      // the scope duplicated in both branches
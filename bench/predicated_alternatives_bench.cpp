@@ -0,0 +1,103 @@
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Cost per scope of predicated construction and its alternatives (see
+// predicated_alternatives.cpp) for conditions that are true 0%, 1%, 50% and
+// 100% of the time, in a random pattern. Reports the best of five runs and
+// the branch misses per scope of one more run, through perf_counters.hpp
+// when the hardware counters are available. Stack and code size come from
+// predicated_alternatives_size.py.
+//
+//	predicated_alternatives_bench [scopes]
+
+#include "predicated_alternatives.hpp"
+
+#include "perf_counters.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+typedef int (*alternative)(bool, int);
+
+struct variant
+{
+	const char* name;
+	alternative f;
+};
+
+const variant variants[] =
+{
+	{ "predicated", &alternative_predicated },
+	{ "optional", &alternative_optional },
+	{ "unique_ptr", &alternative_unique_ptr },
+	{ "flag", &alternative_flag },
+	{ "duplicated", &alternative_duplicated }
+};
+
+const int rates[] = { 0, 1, 50, 100 };
+
+volatile long sink;
+
+void run(alternative f, const std::vector<char>& conditions)
+{
+	long acc = 0;
+	for (std::size_t i = 0; i < conditions.size(); ++i)
+		acc += f(conditions[i] != 0, int(i));
+	sink = acc;
+}
+
+double time_per_scope(alternative f, const std::vector<char>& conditions)
+{
+	double best = 0;
+	for (int repeat = 0; repeat < 5; ++repeat)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		run(f, conditions);
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		const double ns = elapsed.count() / double(conditions.size());
+		if (!repeat || ns < best)
+			best = ns;
+	}
+	return best;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	const std::size_t scopes = argc > 1 ? std::strtoul(argv[1], 0, 10) : 1ul << 22;
+	static boost::perf_counters::call_site site("alternatives", __FILE__, __LINE__);
+	const bool counters = boost::perf_counters::available();
+
+	std::printf("%-6s %-12s %10s %16s\n", "true", "variant", "ns/scope", "branch misses");
+	for (std::size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); ++r)
+	{
+		std::mt19937 random(42);
+		std::vector<char> conditions(scopes);
+		for (std::size_t i = 0; i < scopes; ++i)
+			conditions[i] = int(random() % 100) < rates[r];
+
+		for (std::size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); ++v)
+		{
+			const double ns = time_per_scope(variants[v].f, conditions);
+			if (counters)
+			{
+				const boost::uint64_t before = site.total(boost::perf_counters::branch_misses);
+				{
+					boost::perf_counters::counter_scope measure(site);
+					run(variants[v].f, conditions);
+				}
+				const boost::uint64_t misses = site.total(boost::perf_counters::branch_misses) - before;
+				std::printf("%5d%% %-12s %10.2f %16.4f\n", rates[r], variants[v].name, ns, double(misses) / double(scopes));
+			}
+			else
+				std::printf("%5d%% %-12s %10.2f %16s\n", rates[r], variants[v].name, ns, "unavailable");
+		}
+	}
+}
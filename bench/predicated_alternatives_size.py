@@ -0,0 +1,63 @@
+#  Distributed under the Boost
+#  Software License, Version 1.0. (See accompanying file
+#  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+# Stack use and code size of the variants in predicated_alternatives.cpp,
+# from the object file compiled with -fstack-usage (GCC, Clang):
+#
+#	python3 bench/predicated_alternatives_size.py build/.../predicated_alternatives.cpp.o
+#
+# Stack use is the frame size GCC reports in the .su file written next to
+# the object; code size adds up the symbols of each variant, including
+# [clone .cold] parts, as listed by nm.
+
+import os
+import re
+import subprocess
+import sys
+
+VARIANTS = ('predicated', 'optional', 'unique_ptr', 'flag', 'duplicated')
+
+
+def stack_usage(obj):
+	su = os.path.splitext(obj)[0] + '.su'
+	usage = {}
+	if not os.path.exists(su):
+		return usage
+	with open(su) as f:
+		for line in f:
+			fields = line.rstrip('\n').split('\t')
+			m = re.search(r'alternative_(\w+)', fields[0])
+			if m and len(fields) == 3:
+				usage[m.group(1)] = '%s (%s)' % (fields[1], fields[2])
+	return usage
+
+
+def code_size(obj):
+	sizes = {}
+	output = subprocess.run(['nm', '-S', obj], check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+	for line in output.splitlines():
+		fields = line.split()
+		if len(fields) != 4:
+			continue
+		m = re.match(r'alternative_([a-z_]+?)(\.cold)?$', fields[3])
+		if m:
+			sizes[m.group(1)] = sizes.get(m.group(1), 0) + int(fields[1], 16)
+	return sizes
+
+
+def main():
+	if len(sys.argv) != 2:
+		print('usage: predicated_alternatives_size.py <object file>')
+		return 2
+	obj = sys.argv[1]
+	usage = stack_usage(obj)
+	sizes = code_size(obj)
+	print('%-12s %18s %12s' % ('variant', 'stack bytes', 'code bytes'))
+	for name in VARIANTS:
+		print('%-12s %18s %12s' % (name, usage.get(name, 'unavailable'), sizes.get(name, 'unavailable')))
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
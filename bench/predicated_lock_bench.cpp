@@ -0,0 +1,69 @@
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Cost per critical section of BOOST_PREDICATED_LOCK with the predicate
+// false (disabled), true on a single thread (uncontended) and true on
+// several threads hammering the same mutex (contended), next to
+// std::mutex for reference.
+//
+//	predicated_lock_bench [iterations] [threads]
+
+#include "predicated_lock.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+boost::predicated_locking::adaptive_mutex adaptive;
+std::mutex standard;
+volatile unsigned long counter;
+
+template <class Section>
+double run(unsigned threads, unsigned long iterations, Section section)
+{
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (unsigned t = 1; t < threads; ++t)
+		workers.push_back(std::thread([=] { for (unsigned long i = 0; i < iterations; ++i) section(); }));
+	for (unsigned long i = 0; i < iterations; ++i)
+		section();
+	for (std::size_t t = 0; t < workers.size(); ++t)
+		workers[t].join();
+	const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / double(iterations * threads);
+}
+
+void predicated(bool enabled)
+{
+	BOOST_PREDICATED_LOCK(enabled, adaptive);
+	counter = counter + 1;
+}
+
+void locked()
+{
+	std::lock_guard<std::mutex> lock(standard);
+	counter = counter + 1;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	const unsigned long iterations = argc > 1 ? std::strtoul(argv[1], 0, 10) : 10000000ul;
+	unsigned threads = argc > 2 ? unsigned(std::strtoul(argv[2], 0, 10)) : std::thread::hardware_concurrency();
+	if (threads < 2)
+		threads = 2;
+
+	std::printf("%-12s %-24s %10s\n", "mode", "lock", "ns/section");
+	std::printf("%-12s %-24s %10.2f\n", "disabled", "BOOST_PREDICATED_LOCK", run(1, iterations, [] { predicated(false); }));
+	std::printf("%-12s %-24s %10.2f\n", "uncontended", "BOOST_PREDICATED_LOCK", run(1, iterations, [] { predicated(true); }));
+	std::printf("%-12s %-24s %10.2f\n", "uncontended", "std::mutex", run(1, iterations, [] { locked(); }));
+	std::printf("%-12s %-24s %10.2f  (%u threads)\n", "contended", "BOOST_PREDICATED_LOCK", run(threads, iterations / threads, [] { predicated(true); }), threads);
+	std::printf("%-12s %-24s %10.2f  (%u threads)\n", "contended", "std::mutex", run(threads, iterations / threads, [] { locked(); }), threads);
+}
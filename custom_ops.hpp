@@ -75,6 +75,86 @@ Notes:
 
 	* supported prefix unary operators are + - & * ++ -- ! ~
 
+Overload set growth:
+
+	Each BOOST_CUSTOM_OP adds a non-template operator lastop and an operator
+	binop to the scope it's expanded in. At global scope every unary - or ~
+	in the translation unit - including ones that have nothing to do with
+	custom operators - considers all of them during overload resolution, and
+	with hundreds of custom operators that becomes a noticeable part of the
+	compile time. There are two ways to keep them out of unrelated lookups:
+
+	* expand BOOST_CUSTOM_OP in the namespace of the right-hand type. Both
+	generated operators are then found by argument dependent lookup wherever
+	that type is involved, and not at all elsewhere outside the namespace.
+
+	* BOOST_CUSTOM_OP_FRIEND, with the same arguments, expanded inside the
+	definition of the right-hand class, makes the operators hidden friends.
+	They are only found through ADL on that class (the wrapped<> chain the
+	binary operator receives has it as a template argument), not even by
+	code in the same namespace:
+
+		struct B
+		{
+			int b;
+
+			BOOST_CUSTOM_OP_FRIEND(int, const A&, a, /, ~+, -, const B&, b)
+			{
+				return a.value() * 2 + b.b * 3;
+			}
+		};
+
+	The body is a static member function of the class, so it has access to
+	private members. Neither form works for fundamental right-hand types
+	wrapped with boost::ref(), whose operators have to stay global.
+
+	bench/compile_time_overloads.py measures the three placements against
+	each other for a given compiler.
+
+Debug builds:
+
+	Without optimization every unary operator of the string is a real call,
+	plus a copy of the intermediate wrapped<> object each time. Defining
+	BOOST_CUSTOM_OPS_FORCE_INLINE before including this header marks the
+	wrapping machinery always-inline, which GCC, Clang and MSVC honour even
+	at -O0 / /Od (MSVC with /Ob1), so an application of a custom operator
+	comes down to the call of its body. On GCC (and Clang versions that
+	know it) the functions are also marked artificial, so the debugger
+	steps straight into the body and doesn't show the inlined layers in
+	backtraces. The generated operators become inline functions in this
+	mode.
+
+	With optimization the wrapping layers are normally inlined away, and
+	a /~+!- b compiles to exactly the code of the body written out at the
+	call site. Defining BOOST_CUSTOM_OPS_FORCE_INLINE in optimized builds
+	too keeps that from depending on the compiler's inlining heuristics.
+	tests/codegen checks both properties on x86-64.
+
+Lazy right operands:
+
+	An overloaded && or || can't short-circuit: both operands are evaluated
+	before the operator is called. BOOST_CUSTOM_LAZY_OP takes the same
+	arguments as BOOST_CUSTOM_OP, but the right operand is passed to the body
+	as a deferred thunk that computes it on demand, and the call site wraps the
+	right-hand expression with BOOST_CUSTOM_OP_DEFER:
+
+		BOOST_CUSTOM_LAZY_OP(predicate, const predicate&, a, &&, , ~, bool, b)
+		{
+			return a.selective() ? a && b() : predicate::none();
+		}
+
+		predicate p = column_filter &&~ BOOST_CUSTOM_OP_DEFER(expensive_check(row));
+
+	'b' is a boost::custom_ops::deferred<bool>; b() evaluates the wrapped
+	expression each time it's called, so call it at most once. It returns
+	by value even when param2type is a reference (const big&, say): the
+	result is a temporary of the thunk and wouldn't outlive the call. The wrapped
+	expression is captured by reference in a lambda that lives until the end
+	of the full expression - the body must not keep the thunk. An existing
+	function object f can be passed with boost::custom_ops::defer(f) instead.
+	Since the thunk is a class type, param2type may be a fundamental type
+	here, without boost::ref().
+
 A full example:
 
 	#include "custom_ops.hpp"
@@ -106,6 +186,7 @@ A full example:
 	}
 */
 
+#include <boost/config.hpp>
 #include <boost/typeof/typeof.hpp>
 #include <boost/preprocessor/cat.hpp>
 
@@ -117,6 +198,22 @@ A full example:
 #include <boost/type_traits/remove_reference.hpp>
 #include <boost/type_traits/is_reference.hpp>
 #include <boost/type_traits/add_const.hpp>
+#include <boost/type_traits/decay.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include <boost/utility/enable_if.hpp>
+
+#if defined(BOOST_CUSTOM_OPS_FORCE_INLINE)
+#if defined(__GNUC__) && defined(__has_attribute)
+#if __has_attribute(__artificial__)
+#define BOOST_COPS_FORCEINLINE inline __attribute__((__always_inline__, __artificial__))
+#endif
+#endif
+#if !defined(BOOST_COPS_FORCEINLINE)
+#define BOOST_COPS_FORCEINLINE BOOST_FORCEINLINE
+#endif
+#else
+#define BOOST_COPS_FORCEINLINE
+#endif
 
 namespace boost {
 namespace custom_ops {
@@ -167,11 +264,11 @@ template <class T, class Tag>
 struct wrapped
 {
 	typedef typename unwrap<T>::type type;
-	explicit wrapped(type t)
+	BOOST_COPS_FORCEINLINE explicit wrapped(type t)
 		: value(t)
 	{}
-	template <class U, class Tag>
-	explicit wrapped(wrapped<U, Tag> u)
+	template <class U, class Tag2>
+	BOOST_COPS_FORCEINLINE explicit wrapped(wrapped<U, Tag2> u)
 		: value(u.value)
 	{}
 
@@ -203,7 +300,7 @@ template <class T> type_finder_impl<T> type_finder<T>::f;
 
 #define BOOST_COPS_MAKE_WRAPPING_OPERATORS(OP) \
 	template <class T, class Tag> \
-	wrapped<wrapped<T, Tag>, BOOST_COPS_OPTAG(OP)> operator OP (wrapped<T, Tag> w) \
+	BOOST_COPS_FORCEINLINE wrapped<wrapped<T, Tag>, BOOST_COPS_OPTAG(OP)> operator OP (wrapped<T, Tag> w) \
 	{ \
 		return wrapped<wrapped<T, Tag>, BOOST_COPS_OPTAG(OP)>(w); \
 	}
@@ -212,6 +309,85 @@ BOOST_COPS_ITERATE_OPS(BOOST_COPS_MAKE_WRAPPING_OPERATORS)
 
 #undef BOOST_COPS_MAKE_WRAPPING_OPERATORS
 
+template <class F>
+struct lazy_operand
+{
+	BOOST_COPS_FORCEINLINE explicit lazy_operand(const F& f)
+		: f(f)
+	{}
+
+	F f;
+};
+
+template <class F>
+BOOST_COPS_FORCEINLINE lazy_operand<F> defer(const F& f)
+{
+	return lazy_operand<F>(f);
+}
+
+#define BOOST_COPS_MAKE_LAZY_OPERATORS(OP) \
+	template <class F> \
+	BOOST_COPS_FORCEINLINE wrapped<lazy_operand<F>, BOOST_COPS_OPTAG(OP)> operator OP (const lazy_operand<F>& l) \
+	{ \
+		return wrapped<lazy_operand<F>, BOOST_COPS_OPTAG(OP)>(l); \
+	}
+
+BOOST_COPS_ITERATE_OPS(BOOST_COPS_MAKE_LAZY_OPERATORS)
+
+#undef BOOST_COPS_MAKE_LAZY_OPERATORS
+
+// Stands in for lazy_operand<F> when matching the operator string of a lazy
+// operator, which doesn't depend on F.
+struct lazy_placeholder {};
+
+template <class W>
+struct rebind_lazy
+{
+	typedef W type;
+};
+
+template <class F>
+struct rebind_lazy<lazy_operand<F>>
+{
+	typedef lazy_placeholder type;
+};
+
+template <class W, class Tag>
+struct rebind_lazy<wrapped<W, Tag>>
+{
+	typedef wrapped<typename rebind_lazy<W>::type, Tag> type;
+};
+
+// Non-owning handle to a lazy operand, evaluated by operator (). The value
+// is returned by value even if T is a reference: the wrapped expression is
+// a temporary of the thunk, gone by the time a reference could be used.
+template <class T>
+class deferred
+{
+public:
+	typedef typename decay<T>::type value_type;
+
+	template <class F>
+	BOOST_COPS_FORCEINLINE explicit deferred(const lazy_operand<F>& l)
+		: _closure(&l.f), _call(&call<F>)
+	{}
+
+	BOOST_COPS_FORCEINLINE value_type operator () () const
+	{
+		return _call(_closure);
+	}
+
+private:
+	template <class F>
+	static value_type call(const void* f)
+	{
+		return (*static_cast<const F*>(f))();
+	}
+
+	const void* _closure;
+	value_type (*_call)(const void*);
+};
+
 #undef BOOST_COPS_ITERATE_OPS
 #undef BOOST_COPS_OPTAG
 
@@ -219,7 +395,7 @@ template <class T>
 struct cop_reference_wrapper
 	: reference_wrapper<T>
 {
-	cop_reference_wrapper(reference_wrapper<T> w)
+	BOOST_COPS_FORCEINLINE cop_reference_wrapper(reference_wrapper<T> w)
 		: reference_wrapper<T>(w)
 	{}
 };
@@ -243,13 +419,42 @@ struct reasonable_type_for_unary_operator_overload
 }
 }
 
+#define BOOST_COPS_UNARY_OPERATOR(firstop, param2type) \
+	BOOST_COPS_FORCEINLINE boost::custom_ops::wrapped<param2type, BOOST_TYPEOF(firstop boost::custom_ops::tag_from_op)> operator firstop (boost::custom_ops::reasonable_type_for_unary_operator_overload<param2type>::type w) \
+	{ \
+		return boost::custom_ops::wrapped<param2type, BOOST_TYPEOF(firstop boost::custom_ops::tag_from_op)>(w); \
+	}
+
 #define BOOST_CUSTOM_OP(rettype, param1type, param1name, binop, ops, firstop, param2type, param2name) \
-	boost::custom_ops::wrapped<param2type, BOOST_TYPEOF(firstop boost::custom_ops::tag_from_op)> operator firstop (boost::custom_ops::reasonable_type_for_unary_operator_overload<param2type>::type w) \
+	BOOST_COPS_UNARY_OPERATOR(firstop, param2type) \
+	static rettype BOOST_PP_CAT(boost_custom_ops_implementation_, __LINE__)(param1type, param2type); \
+	BOOST_COPS_FORCEINLINE rettype operator binop (param1type a, BOOST_TYPEOF(ops firstop boost::custom_ops::type_finder<param2type>::f)::type b) \
+	{ \
+		return BOOST_PP_CAT(boost_custom_ops_implementation_, __LINE__)(a, b.value); \
+	} \
+	static rettype BOOST_PP_CAT(boost_custom_ops_implementation_, __LINE__)(param1type param1name, param2type param2name)
+
+#define BOOST_CUSTOM_LAZY_OP(rettype, param1type, param1name, binop, ops, firstop, param2type, param2name) \
+	static rettype BOOST_PP_CAT(boost_custom_ops_implementation_, __LINE__)(param1type, const boost::custom_ops::deferred<param2type>&); \
+	template <class W> \
+	BOOST_COPS_FORCEINLINE typename boost::enable_if< \
+		boost::is_same<typename boost::custom_ops::rebind_lazy<W>::type, BOOST_TYPEOF(ops firstop boost::custom_ops::type_finder<boost::custom_ops::lazy_placeholder>::f)::type>, \
+		rettype \
+	>::type operator binop (param1type a, W b) \
+	{ \
+		return BOOST_PP_CAT(boost_custom_ops_implementation_, __LINE__)(a, boost::custom_ops::deferred<param2type>(b.value)); \
+	} \
+	static rettype BOOST_PP_CAT(boost_custom_ops_implementation_, __LINE__)(param1type param1name, const boost::custom_ops::deferred<param2type>& param2name)
+
+#define BOOST_CUSTOM_OP_DEFER(...) \
+	::boost::custom_ops::defer([&]() { return __VA_ARGS__; })
+
+#define BOOST_CUSTOM_OP_FRIEND(rettype, param1type, param1name, binop, ops, firstop, param2type, param2name) \
+	friend BOOST_COPS_FORCEINLINE boost::custom_ops::wrapped<param2type, BOOST_TYPEOF(firstop boost::custom_ops::tag_from_op)> operator firstop (param2type w) \
 	{ \
 		return boost::custom_ops::wrapped<param2type, BOOST_TYPEOF(firstop boost::custom_ops::tag_from_op)>(w); \
 	} \
-	static rettype BOOST_PP_CAT(boost_custom_ops_implementation_, __LINE__)(param1type, param2type); \
-	rettype operator binop (param1type a, BOOST_TYPEOF(ops firstop boost::custom_ops::type_finder<param2type>::f)::type b) \
+	friend BOOST_COPS_FORCEINLINE rettype operator binop (param1type a, BOOST_TYPEOF(ops firstop boost::custom_ops::type_finder<param2type>::f)::type b) \
 	{ \
 		return BOOST_PP_CAT(boost_custom_ops_implementation_, __LINE__)(a, b.value); \
 	} \
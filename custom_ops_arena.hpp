@@ -0,0 +1,120 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Arena-allocating custom operators
+=======================================
+
+Introduction:
+
+	Custom operators that produce strings, vectors or matrices allocate a
+	result per application, and a DSL expression applies dozens of them.
+	When the whole evaluation is short-lived, those results belong in an
+	arena that is released in one go.
+
+	BOOST_CUSTOM_ARENA_OP takes the same arguments as BOOST_CUSTOM_OP. While
+	its body runs, the memory resource of the left operand is the calling
+	thread's current resource (see scoped_arena.hpp), so a body that creates
+	its result from current_resource() allocates it next to its operand:
+
+		typedef std::pmr::string text;
+
+		BOOST_CUSTOM_ARENA_OP(text, const text&, a, +, , ~, const text&, b)
+		{
+			text r(boost::arena_allocation::current_resource());
+			r.reserve(a.size() + b.size());
+			r.append(a).append(b);
+			return r;
+		}
+
+	Since each result is allocated from the resource of its left operand, an
+	arena bound to the first operand propagates through the whole chain:
+
+		std::pmr::monotonic_buffer_resource arena;
+		text head("<", &arena);
+		text html = head +~ tag +~ body +~ tail;   // every temporary in 'arena'
+
+	Left operands that don't carry a resource - any type without a
+	get_allocator().resource(), or one allocated from the default resource -
+	leave the current resource as it is, so an enclosing scoped_arena binds
+	the arena to the whole scope instead:
+
+		BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(pooled, RequestArena, ());
+		text html = text("<") +~ tag +~ body;
+
+Synopsis:
+
+	BOOST_CUSTOM_ARENA_OP(rettype, param1type, param1name, binop, ops, lastop, param2type, param2name)
+	{
+		// user implementation
+	}
+
+	template <class T>
+	std::pmr::memory_resource* operand_resource(const T& operand);
+
+Notes:
+
+	* requires C++17 <memory_resource>.
+
+	* the body has to construct its result with current_resource(); copies
+	of pmr containers don't propagate the allocator (the copy constructor
+	uses the default resource), so 'return a;' - or returning the reference
+	that append() gives back - would escape the arena. Return the local by
+	name; the move keeps its allocator.
+
+	* results allocated from an arena must not outlive it.
+
+*/
+
+#include "custom_ops.hpp"
+#include "scoped_arena.hpp"
+
+#include <memory_resource>
+
+namespace boost {
+namespace custom_ops {
+
+namespace detail {
+
+template <class T>
+auto allocator_resource(const T& t, int)
+	-> decltype(static_cast<std::pmr::memory_resource*>(t.get_allocator().resource()))
+{
+	return t.get_allocator().resource();
+}
+
+template <class T>
+std::pmr::memory_resource* allocator_resource(const T&, long)
+{
+	return 0;
+}
+
+}
+
+// The resource results computed from 'operand' should be allocated from:
+// the operand's own unless that's the default one, otherwise the current.
+template <class T>
+BOOST_COPS_FORCEINLINE std::pmr::memory_resource* operand_resource(const T& operand)
+{
+	std::pmr::memory_resource* r = detail::allocator_resource(operand, 0);
+	if (!r || r == std::pmr::get_default_resource())
+		return ::boost::arena_allocation::current_resource();
+	return r;
+}
+
+}
+}
+
+#define BOOST_CUSTOM_ARENA_OP(rettype, param1type, param1name, binop, ops, firstop, param2type, param2name) \
+	BOOST_COPS_UNARY_OPERATOR(firstop, param2type) \
+	static rettype BOOST_PP_CAT(boost_custom_ops_implementation_, __LINE__)(param1type, param2type); \
+	BOOST_COPS_FORCEINLINE rettype operator binop (param1type a, BOOST_TYPEOF(ops firstop boost::custom_ops::type_finder<param2type>::f)::type b) \
+	{ \
+		::boost::arena_allocation::resource_binding binding(::boost::custom_ops::operand_resource(a)); \
+		return BOOST_PP_CAT(boost_custom_ops_implementation_, __LINE__)(a, b.value); \
+	} \
+	static rettype BOOST_PP_CAT(boost_custom_ops_implementation_, __LINE__)(param1type param1name, param2type param2name)
@@ -0,0 +1,387 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Deferred destruction
+==========================
+
+Introduction:
+
+	Destroying a multi-gigabyte hash table or mesh cache takes a long time,
+	and with ordinary scoping that time is spent on whatever thread leaves the
+	scope - usually the one that can least afford it. Deferred construction
+	is a flavor of predicated construction whose objects are destroyed on a
+	background reclamation thread instead:
+
+		BOOST_PREDICATED_DEFERRED_CONSTRUCTOR(needIndex, index, HugeIndex, (records));
+		...
+		// on scope exit 'index' is handed to the reclaimer with one enqueue
+
+	The object is constructed in a block allocated from the heap (a stack
+	frame can't outlive its scope), and its destructor runs later on the
+	reclaimer's thread. Scope exit costs a single atomic exchange; the
+	enqueue never blocks and never allocates.
+
+	Types whose destructor must run in scope order - because it releases a
+	lock, flushes a file, or anything else the following code relies on -
+	opt out by specializing boost::deferred_destruction::defer:
+
+		namespace boost { namespace deferred_destruction {
+			template <> struct defer<JournalWriter> : boost::false_type {};
+		}}
+
+	Opted-out objects live in aligned storage on the stack and are destroyed
+	in place on scope exit, exactly like with BOOST_PREDICATED_CONSTRUCTOR:
+	no allocation, and their ordering relative to other scoped objects is
+	preserved.
+
+Synopsis:
+
+	template <class T>
+	struct defer : boost::true_type {};
+
+	class reclaimer
+	{
+		reclaimer();
+		~reclaimer();     // destroys everything still pending
+
+		void flush();     // waits until everything enqueued so far is destroyed
+	};
+
+	reclaimer& default_reclaimer();
+
+	BOOST_PREDICATED_DEFERRED_CONSTRUCTOR(condition, name, obj, params)
+	BOOST_PREDICATED_DEFERRED_ANONYMOUS_CONSTRUCTOR(condition, obj, params)
+
+Notes:
+
+	* deferred objects are destroyed in FIFO order per producing thread,
+	but there is no ordering relative to anything else. Their destructors
+	must not touch state owned by the scope that created them.
+
+	* the queue is an intrusive multi-producer, single-consumer queue; the
+	link lives in the object's heap block. The reclaimer thread sleeps on a
+	condition variable when idle; producers only take its mutex to wake it
+	up when it is actually asleep.
+
+	* the default reclaimer is a function-local static; its thread is
+	started on first use and joined (after draining the queue) at exit.
+	Deferring destruction after it has been destroyed is undefined.
+
+	* types aligned stricter than std::max_align_t are not supported.
+
+*/
+
+#include "predicated_construction.hpp"
+
+#include <boost/noncopyable.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/aligned_storage.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <thread>
+
+namespace boost {
+namespace deferred_destruction {
+
+template <class T>
+struct defer
+	: true_type
+{};
+
+namespace detail {
+
+struct node
+{
+	std::atomic<node*> next;
+	void (*reclaim)(node* n);
+};
+
+union node_header
+{
+	node n;
+	std::max_align_t align;
+};
+
+inline void* object_of(node* n)
+{
+	return reinterpret_cast<char*>(n) + sizeof(node_header);
+}
+
+inline node* node_of(void* object)
+{
+	return reinterpret_cast<node*>(static_cast<char*>(object) - sizeof(node_header));
+}
+
+template <class T>
+void reclaim(node* n)
+{
+	static_cast<T*>(object_of(n))->~T();
+	std::free(n);
+}
+
+struct flush_marker
+{
+	node n;
+	std::atomic<bool> reached;
+
+	static void reclaim(node* n)
+	{
+		reinterpret_cast<flush_marker*>(n)->reached.store(true, std::memory_order_release);
+	}
+};
+
+struct allocation_tag {};
+
+}
+
+class reclaimer
+	: noncopyable
+{
+public:
+	reclaimer()
+		: _head(&_stub), _tail(&_stub), _sleeping(false), _stopping(false)
+	{
+		_stub.next.store(0, std::memory_order_relaxed);
+		_thread = std::thread(&reclaimer::run, this);
+	}
+
+	~reclaimer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_wake.notify_one();
+		_thread.join();
+	}
+
+	// Takes ownership of a constructed object living in a node allocated by
+	// operator new(std::size_t, detail::allocation_tag).
+	void enqueue(detail::node* n)
+	{
+		push(n);
+		if (_sleeping.load(std::memory_order_seq_cst))
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_wake.notify_one();
+		}
+	}
+
+	// Blocks until every object enqueued before the call has been destroyed.
+	void flush()
+	{
+		detail::flush_marker marker;
+		marker.n.reclaim = &detail::flush_marker::reclaim;
+		marker.reached.store(false, std::memory_order_relaxed);
+		enqueue(&marker.n);
+		while (!marker.reached.load(std::memory_order_acquire))
+			std::this_thread::yield();
+	}
+
+private:
+	void push(detail::node* n)
+	{
+		n->next.store(0, std::memory_order_relaxed);
+		detail::node* prev = _head.exchange(n, std::memory_order_seq_cst);
+		prev->next.store(n, std::memory_order_release);
+	}
+
+	detail::node* pop()
+	{
+		detail::node* tail = _tail;
+		detail::node* next = tail->next.load(std::memory_order_acquire);
+		if (tail == &_stub)
+		{
+			if (!next)
+				return 0;
+			_tail = tail = next;
+			next = next->next.load(std::memory_order_acquire);
+		}
+		if (next)
+		{
+			_tail = next;
+			return tail;
+		}
+		if (tail != _head.load(std::memory_order_acquire))
+			return 0; // a producer is between the exchange and the link
+		push(&_stub);
+		next = tail->next.load(std::memory_order_acquire);
+		if (next)
+		{
+			_tail = next;
+			return tail;
+		}
+		return 0;
+	}
+
+	bool empty() const
+	{
+		return _head.load(std::memory_order_seq_cst) == _tail
+			&& _tail->next.load(std::memory_order_acquire) == 0;
+	}
+
+	void drain()
+	{
+		while (detail::node* n = pop())
+			n->reclaim(n);
+	}
+
+	void run()
+	{
+		for (;;)
+		{
+			drain();
+			std::unique_lock<std::mutex> lock(_mutex);
+			_sleeping.store(true, std::memory_order_seq_cst);
+			if (empty())
+			{
+				if (_stopping)
+					break;
+				_wake.wait(lock);
+			}
+			_sleeping.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	std::atomic<detail::node*> _head;
+	detail::node* _tail;
+	detail::node _stub;
+
+	std::atomic<bool> _sleeping;
+	bool _stopping;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+
+	std::thread _thread;
+};
+
+inline reclaimer& default_reclaimer()
+{
+	static reclaimer r;
+	return r;
+}
+
+namespace detail {
+
+// The object is placed with new (storage.placement()) and handed over with
+// commit(): in a heap block for deferred types, in place otherwise.
+template <class T, bool Deferred = defer<T>::value>
+struct deferred_constructee_storage
+	: noncopyable
+{
+	BOOST_STATIC_ASSERT(alignment_of<T>::value <= alignment_of<std::max_align_t>::value);
+
+	deferred_constructee_storage()
+		: _t(0)
+	{}
+
+	~deferred_constructee_storage()
+	{
+		if (_t)
+			default_reclaimer().enqueue(node_of(_t));
+	}
+
+	allocation_tag placement() const
+	{
+		return allocation_tag();
+	}
+
+	void commit(T* t)
+	{
+		_t = t;
+		if (_t)
+			node_of(_t)->reclaim = &reclaim<T>;
+	}
+
+	T* operator -> () const
+	{
+		return _t;
+	}
+
+	T& operator * () const
+	{
+		return *_t;
+	}
+
+private:
+	T* _t;
+};
+
+template <class T>
+struct deferred_constructee_storage<T, false>
+	: noncopyable
+{
+	deferred_constructee_storage()
+		: _t(0)
+	{}
+
+	~deferred_constructee_storage()
+	{
+		if (_t)
+			_t->~T();
+	}
+
+	void* placement()
+	{
+		return &_mem;
+	}
+
+	void commit(T* t)
+	{
+		_t = t;
+	}
+
+	T* operator -> () const
+	{
+		return _t;
+	}
+
+	T& operator * () const
+	{
+		return *_t;
+	}
+
+private:
+	typename ::boost::aligned_storage<
+		sizeof(T), ::boost::alignment_of<T>::value
+	>::type _mem;
+	T* _t;
+};
+
+}
+
+}
+}
+
+inline void* operator new(std::size_t size, const ::boost::deferred_destruction::detail::allocation_tag&)
+{
+	void* p = std::malloc(sizeof(::boost::deferred_destruction::detail::node_header) + size);
+	if (!p)
+		throw std::bad_alloc();
+	return ::boost::deferred_destruction::detail::object_of(static_cast< ::boost::deferred_destruction::detail::node*>(p));
+}
+
+inline void operator delete(void* object, const ::boost::deferred_destruction::detail::allocation_tag&)
+{
+	std::free(::boost::deferred_destruction::detail::node_of(object));
+}
+
+#define BOOST_PREDICATED_DEFERRED_ANONYMOUS_CONSTRUCTOR(condition, obj, params) \
+	::boost::deferred_destruction::detail::deferred_constructee_storage<obj> BOOST_PP_CAT(_deferred_##obj,__LINE__); \
+	BOOST_PP_CAT(_deferred_##obj,__LINE__).commit((condition) ? new (BOOST_PP_CAT(_deferred_##obj,__LINE__).placement()) obj params : 0)
+
+#define BOOST_PREDICATED_DEFERRED_CONSTRUCTOR(condition, name, obj, params) \
+	BOOST_PREDICATED_DEFERRED_ANONYMOUS_CONSTRUCTOR(condition, obj, params); \
+	obj& name = *BOOST_PP_CAT(_deferred_##obj,__LINE__)
@@ -0,0 +1,314 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Epoch-based reclamation
+=============================
+
+Introduction:
+
+	Readers of a concurrently updated structure must be protected from
+	writers freeing the nodes they are looking at. A shared_mutex does that,
+	but every reader writes to the mutex's reader count, and that cache line
+	ends up bouncing between all the cores.
+
+	With epoch-based reclamation (EBR) a reader only announces, in a slot of
+	its own, that it is inside a read-side critical section and which epoch
+	it saw on entry. Writers unlink nodes and retire them instead of freeing
+	them; a retired node is freed once every thread has been observed
+	outside of a critical section or in a later epoch, that is, once the
+	global epoch has advanced twice since the node was retired.
+
+	The read-side guard is a sentry, so it composes with predicated
+	construction. When the structure is known to be quiescent - nobody is
+	retiring anything, e.g. during a read-only phase - readers can skip
+	pinning altogether:
+
+		static boost::epoch_reclamation::epoch_domain domain;
+
+		typedef boost::epoch_reclamation::read_guard EpochGuard;
+		BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(!table.quiescent(), EpochGuard, (domain));
+		node* n = table.find(key);
+
+	Writers retire what they unlink:
+
+		node* old = bucket.exchange(replacement);
+		domain.retire(old);
+
+Synopsis:
+
+	class epoch_domain
+	{
+		epoch_domain();
+		~epoch_domain();    // frees everything still retired
+
+		template <class T> void retire(T* p);             // deleted with 'delete'
+		void retire(void* p, void (*deleter)(void*));
+		void collect();     // tries to advance the epoch and free what's safe
+	};
+
+	class read_guard
+	{
+		explicit read_guard(epoch_domain& domain);
+	};
+
+	BOOST_EPOCH_READ_GUARD(condition, domain)
+
+Notes:
+
+	* pinning is a store to a thread-owned slot followed by a full fence;
+	unpinning is a plain release store. Guards nest; only the outermost one
+	pins.
+
+	* each thread keeps its own retire list. Once it holds
+	BOOST_EPOCH_COLLECT_THRESHOLD objects, retire() tries to advance the
+	global epoch and frees the objects whose grace period has passed.
+
+	* a thread's slot is recycled when the thread exits; objects it left
+	retired are inherited by the next thread to take the slot, or freed
+	when the domain is destroyed.
+
+	* a program may have at most BOOST_EPOCH_MAX_DOMAINS domains. Domains
+	are meant to have static storage duration and must outlive every thread
+	that used them.
+
+	* skipping the guard is only correct while no thread retires objects
+	from the structure being read.
+
+*/
+
+#include "predicated_construction.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#ifndef BOOST_EPOCH_COLLECT_THRESHOLD
+#define BOOST_EPOCH_COLLECT_THRESHOLD 64
+#endif
+
+#ifndef BOOST_EPOCH_MAX_DOMAINS
+#define BOOST_EPOCH_MAX_DOMAINS 16
+#endif
+
+namespace boost {
+namespace epoch_reclamation {
+
+namespace detail {
+
+struct retired
+{
+	void* p;
+	void (*deleter)(void*);
+	uint64_t epoch;
+};
+
+struct thread_record
+	: noncopyable
+{
+	thread_record()
+		: state(0), in_use(true), depth(0), next(0)
+	{}
+
+	// (epoch << 1) | 1 while pinned, 0 otherwise. Written only by the owner.
+	std::atomic<uint64_t> state;
+	std::atomic<bool> in_use;
+
+	// Owner-only state.
+	unsigned depth;
+	std::vector<retired> garbage;
+
+	thread_record* next;
+};
+
+template <class T>
+void delete_object(void* p)
+{
+	delete static_cast<T*>(p);
+}
+
+}
+
+class epoch_domain
+	: noncopyable
+{
+public:
+	epoch_domain()
+		: _epoch(0), _records(0), _slot(next_slot())
+	{}
+
+	~epoch_domain()
+	{
+		detail::thread_record* r = _records.load(std::memory_order_acquire);
+		while (r)
+		{
+			for (std::size_t i = 0; i < r->garbage.size(); ++i)
+				r->garbage[i].deleter(r->garbage[i].p);
+			detail::thread_record* next = r->next;
+			delete r;
+			r = next;
+		}
+	}
+
+	template <class T>
+	void retire(T* p)
+	{
+		retire(p, &detail::delete_object<T>);
+	}
+
+	void retire(void* p, void (*deleter)(void*))
+	{
+		detail::thread_record& r = local();
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		detail::retired item = { p, deleter, _epoch.load(std::memory_order_relaxed) };
+		r.garbage.push_back(item);
+		if (r.garbage.size() >= BOOST_EPOCH_COLLECT_THRESHOLD)
+			collect(r);
+	}
+
+	void collect()
+	{
+		collect(local());
+	}
+
+	void pin()
+	{
+		detail::thread_record& r = local();
+		if (r.depth++ == 0)
+		{
+			const uint64_t e = _epoch.load(std::memory_order_relaxed);
+			r.state.store((e << 1) | 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+	}
+
+	void unpin()
+	{
+		detail::thread_record& r = local();
+		if (--r.depth == 0)
+			r.state.store(0, std::memory_order_release);
+	}
+
+private:
+	struct thread_slots
+	{
+		detail::thread_record* records[BOOST_EPOCH_MAX_DOMAINS];
+
+		~thread_slots()
+		{
+			for (unsigned i = 0; i < BOOST_EPOCH_MAX_DOMAINS; ++i)
+				if (records[i])
+					records[i]->in_use.store(false, std::memory_order_release);
+		}
+	};
+
+	static unsigned next_slot()
+	{
+		static std::atomic<unsigned> slots(0);
+		const unsigned slot = slots.fetch_add(1, std::memory_order_relaxed);
+		if (slot >= BOOST_EPOCH_MAX_DOMAINS)
+			throw std::length_error("boost::epoch_reclamation: too many epoch domains");
+		return slot;
+	}
+
+	detail::thread_record& local()
+	{
+		static thread_local thread_slots slots = thread_slots();
+		detail::thread_record*& r = slots.records[_slot];
+		if (!r)
+			r = &acquire_record();
+		return *r;
+	}
+
+	detail::thread_record& acquire_record()
+	{
+		for (detail::thread_record* r = _records.load(std::memory_order_acquire); r; r = r->next)
+		{
+			bool expected = false;
+			if (!r->in_use.load(std::memory_order_relaxed)
+				&& r->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire, std::memory_order_relaxed))
+				return *r;
+		}
+
+		detail::thread_record* r = new detail::thread_record;
+		r->next = _records.load(std::memory_order_relaxed);
+		while (!_records.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed))
+			;
+		return *r;
+	}
+
+	// Advances the global epoch if every pinned thread has seen the current one.
+	bool try_advance()
+	{
+		const uint64_t e = _epoch.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		for (detail::thread_record* r = _records.load(std::memory_order_acquire); r; r = r->next)
+		{
+			const uint64_t s = r->state.load(std::memory_order_relaxed);
+			if ((s & 1) && (s >> 1) != e)
+				return false;
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t expected = e;
+		_epoch.compare_exchange_strong(expected, e + 1, std::memory_order_release, std::memory_order_relaxed);
+		return true;
+	}
+
+	void collect(detail::thread_record& r)
+	{
+		try_advance();
+		const uint64_t e = _epoch.load(std::memory_order_acquire);
+		std::size_t kept = 0;
+		for (std::size_t i = 0; i < r.garbage.size(); ++i)
+		{
+			if (r.garbage[i].epoch + 2 <= e)
+				r.garbage[i].deleter(r.garbage[i].p);
+			else
+				r.garbage[kept++] = r.garbage[i];
+		}
+		r.garbage.resize(kept);
+	}
+
+	std::atomic<uint64_t> _epoch;
+	std::atomic<detail::thread_record*> _records;
+	const unsigned _slot;
+};
+
+class read_guard
+	: noncopyable
+{
+public:
+	explicit read_guard(epoch_domain& domain)
+		: _domain(domain)
+	{
+		_domain.pin();
+	}
+
+	~read_guard()
+	{
+		_domain.unpin();
+	}
+
+private:
+	epoch_domain& _domain;
+};
+
+}
+}
+
+#define BOOST_EPOCH_READ_GUARD(condition, domain) \
+	BOOST_EPOCH_READ_GUARD_I(condition, domain, BOOST_PP_CAT(_epoch_read_guard_,__LINE__))
+
+// The predicated constructor pastes its type into the names of its storage,
+// so the guard type goes in through a hidden, line-unique typedef.
+#define BOOST_EPOCH_READ_GUARD_I(condition, domain, guard_type) \
+	typedef ::boost::epoch_reclamation::read_guard guard_type; \
+	BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(condition, guard_type, (domain))
@@ -0,0 +1,224 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Scoped floating-point modes
+=================================
+
+Introduction:
+
+	Denormal operands make some FPUs drop to microcode, and a DSP filter
+	decaying towards zero can easily run a hundred times slower than usual.
+	The cure is to switch on flush-to-zero (FTZ) and denormals-are-zero
+	(DAZ) - but only for the kernels that need it, and the previous mode
+	must be restored on every way out of the kernel, or it leaks into code
+	that expects IEEE semantics.
+
+	scoped_fp_mode sets the requested bits of the floating-point control
+	register on construction and puts back the previous values on
+	destruction. It fits predicated construction, so the mode switch can be
+	limited to the inputs that actually produce denormals:
+
+		typedef boost::fp_mode::scoped_fp_mode FpMode;
+		BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(filter.decaying(), FpMode,
+			(boost::fp_mode::flush_to_zero | boost::fp_mode::denormals_are_zero));
+		filter.process(samples, n);
+
+Synopsis:
+
+	enum flags
+	{
+		flush_to_zero = 1,
+		denormals_are_zero = 2
+	};
+
+	enum rounding
+	{
+		round_unchanged,
+		round_to_nearest,
+		round_downward,
+		round_upward,
+		round_toward_zero
+	};
+
+	class scoped_fp_mode
+	{
+		explicit scoped_fp_mode(unsigned flags, rounding r = round_unchanged);
+	};
+
+Notes:
+
+	* on x86 the SSE control/status register (MXCSR) is used. Only the FTZ,
+	DAZ and rounding control bits are restored on exit; exception flags
+	raised inside the scope are left alone so they can still be inspected.
+
+	* on AArch64 FTZ maps to the FZ bit of FPCR; there is no separate DAZ
+	bit, FZ covers inputs as well. Elsewhere only the rounding mode is
+	supported (through <cfenv>) and the flags are ignored.
+
+	* x87 code is not affected; neither is code running on other threads,
+	since the control register is per thread.
+
+	* without '#pragma STDC FENV_ACCESS ON' (or an equivalent compiler
+	switch) the compiler is free to constant-fold floating-point expressions
+	with the default mode, or to move them across the mode switch.
+
+*/
+
+#include "predicated_construction.hpp"
+
+#include <boost/noncopyable.hpp>
+
+#include <new>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define BOOST_FP_MODE_MXCSR
+#include <xmmintrin.h>
+#elif defined(__aarch64__) && defined(__GNUC__)
+#define BOOST_FP_MODE_FPCR
+#else
+#include <cfenv>
+#endif
+
+namespace boost {
+namespace fp_mode {
+
+enum flags
+{
+	flush_to_zero = 1,
+	denormals_are_zero = 2
+};
+
+enum rounding
+{
+	round_unchanged,
+	round_to_nearest,
+	round_downward,
+	round_upward,
+	round_toward_zero
+};
+
+namespace detail {
+
+#if defined(BOOST_FP_MODE_MXCSR)
+
+typedef unsigned int control_word;
+
+inline control_word read()
+{
+	return _mm_getcsr();
+}
+
+inline void write(control_word w)
+{
+	_mm_setcsr(w);
+}
+
+inline control_word mask(unsigned f, rounding r)
+{
+	return ((f & flush_to_zero) ? 0x8000u : 0)
+		| ((f & denormals_are_zero) ? 0x0040u : 0)
+		| (r != round_unchanged ? 0x6000u : 0);
+}
+
+inline control_word bits(unsigned f, rounding r)
+{
+	static const control_word rc[] = { 0, 0x0000u, 0x2000u, 0x4000u, 0x6000u };
+	return ((f & flush_to_zero) ? 0x8000u : 0)
+		| ((f & denormals_are_zero) ? 0x0040u : 0)
+		| rc[r];
+}
+
+#elif defined(BOOST_FP_MODE_FPCR)
+
+typedef unsigned long control_word;
+
+inline control_word read()
+{
+	control_word w;
+	__asm__ __volatile__("mrs %0, fpcr" : "=r"(w));
+	return w;
+}
+
+inline void write(control_word w)
+{
+	__asm__ __volatile__("msr fpcr, %0" : : "r"(w));
+}
+
+inline control_word mask(unsigned f, rounding r)
+{
+	return ((f & (flush_to_zero | denormals_are_zero)) ? 0x1000000ul : 0)
+		| (r != round_unchanged ? 0xc00000ul : 0);
+}
+
+inline control_word bits(unsigned f, rounding r)
+{
+	static const control_word rm[] = { 0, 0x000000ul, 0x800000ul, 0x400000ul, 0xc00000ul };
+	return ((f & (flush_to_zero | denormals_are_zero)) ? 0x1000000ul : 0)
+		| rm[r];
+}
+
+#else
+
+typedef int control_word;
+
+inline control_word read()
+{
+	return std::fegetround();
+}
+
+inline void write(control_word w)
+{
+	std::fesetround(w);
+}
+
+inline control_word mask(unsigned, rounding r)
+{
+	return r != round_unchanged ? ~0 : 0;
+}
+
+inline control_word bits(unsigned, rounding r)
+{
+	switch (r)
+	{
+	case round_to_nearest: return FE_TONEAREST;
+	case round_downward: return FE_DOWNWARD;
+	case round_upward: return FE_UPWARD;
+	case round_toward_zero: return FE_TOWARDZERO;
+	default: return read();
+	}
+}
+
+#endif
+
+}
+
+class scoped_fp_mode
+	: noncopyable
+{
+public:
+	explicit scoped_fp_mode(unsigned f, rounding r = round_unchanged)
+		: _mask(detail::mask(f, r))
+		, _saved(detail::read())
+	{
+		if (_mask)
+			detail::write((_saved & ~_mask) | detail::bits(f, r));
+	}
+
+	~scoped_fp_mode()
+	{
+		if (_mask)
+			detail::write((detail::read() & ~_mask) | (_saved & _mask));
+	}
+
+private:
+	const detail::control_word _mask;
+	const detail::control_word _saved;
+};
+
+}
+}
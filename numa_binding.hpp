@@ -0,0 +1,261 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	NUMA binding sentries
+===========================
+
+Introduction:
+
+	On a multi-socket machine a thread that wanders to another socket, or
+	that touches memory first-touched by another socket, pays for every
+	cache miss twice. Large jobs therefore want to pin themselves to one
+	NUMA node and allocate there, and put everything back afterwards - on
+	every path out of the job, including exceptions.
+
+	numa_binding does both for the calling thread: it restricts the thread's
+	CPU affinity to the CPUs of a node and makes the node the preferred (or
+	mandatory) source of memory for pages the thread faults in from then
+	on. On destruction the previous affinity and memory policy are restored.
+	Small jobs shouldn't pay for two syscalls and the migration, so the
+	binding is usually predicated:
+
+		typedef boost::numa::numa_binding NodeBinding;
+		BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(rows > 10000000, NodeBinding, (node));
+		run_join(...);
+
+Synopsis:
+
+	enum memory_policy
+	{
+		cpus_only,    // don't touch the memory policy
+		prefer_node,  // allocate on the node, fall back to others when full
+		bind_node     // allocate on the node only
+	};
+
+	int node_count();
+	int current_node();
+
+	class numa_binding
+	{
+		explicit numa_binding(int node, memory_policy policy = prefer_node);
+		explicit numa_binding(const cpu_set_t& cpus);
+		bool bound() const;
+	};
+
+Notes:
+
+	* Linux only; the topology is read from /sys/devices/system/node once
+	and cached. Memory policy is set with the raw set_mempolicy syscall, so
+	libnuma is not required.
+
+	* "scope-local allocations" means pages first touched inside the scope.
+	Memory the allocator already has mapped stays where it is; combine with
+	a scoped arena (scoped_arena.hpp) whose buffer is first touched inside
+	the binding to get all scope-local temporaries on the node.
+
+	* failures (no such node, affinity forbidden by a cpuset, a kernel
+	without NUMA support) leave the thread untouched and make bound()
+	return false; the job then simply runs unbound.
+
+	* on other platforms numa_binding is a no-op and bound() is false.
+
+*/
+
+#include "predicated_construction.hpp"
+
+#include <boost/noncopyable.hpp>
+
+#include <new>
+
+#if defined(__linux__)
+#include <cstdio>
+#include <fstream>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#endif
+
+#ifndef BOOST_NUMA_MAX_NODES
+#define BOOST_NUMA_MAX_NODES 64
+#endif
+
+namespace boost {
+namespace numa {
+
+enum memory_policy
+{
+	cpus_only,
+	prefer_node,
+	bind_node
+};
+
+#if defined(__linux__)
+
+namespace detail {
+
+static const unsigned long node_mask_words = (BOOST_NUMA_MAX_NODES + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long));
+static const unsigned long node_mask_bits = node_mask_words * 8 * sizeof(unsigned long);
+
+struct topology
+{
+	int nodes;
+	cpu_set_t cpus[BOOST_NUMA_MAX_NODES];
+
+	topology()
+		: nodes(0)
+	{
+		for (int n = 0; n < BOOST_NUMA_MAX_NODES; ++n)
+		{
+			CPU_ZERO(&cpus[n]);
+			char path[64];
+			std::snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", n);
+			std::ifstream in(path);
+			if (!in)
+				continue;
+			nodes = n + 1;
+			// Format: "0-15,32-47"
+			int first, last;
+			char c;
+			while (in >> first)
+			{
+				last = first;
+				if (in.peek() == '-')
+					in >> c >> last;
+				for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+					CPU_SET(cpu, &cpus[n]);
+				if (in.peek() == ',')
+					in >> c;
+			}
+		}
+	}
+};
+
+inline const topology& system_topology()
+{
+	static const topology t;
+	return t;
+}
+
+inline long get_mempolicy(int* mode, unsigned long* mask)
+{
+	return ::syscall(SYS_get_mempolicy, mode, mask, node_mask_bits, 0, 0);
+}
+
+inline long set_mempolicy(int mode, const unsigned long* mask)
+{
+	return ::syscall(SYS_set_mempolicy, mode, mode == MPOL_DEFAULT ? 0 : mask, mode == MPOL_DEFAULT ? 0 : node_mask_bits);
+}
+
+}
+
+inline int node_count()
+{
+	return detail::system_topology().nodes;
+}
+
+// The node of the CPU the calling thread is running on, -1 if unknown.
+inline int current_node()
+{
+	unsigned cpu = 0, node = 0;
+	if (::syscall(SYS_getcpu, &cpu, &node, 0) != 0)
+		return -1;
+	return int(node);
+}
+
+class numa_binding
+	: noncopyable
+{
+public:
+	explicit numa_binding(int node, memory_policy policy = prefer_node)
+		: _bound(false), _policy_set(false)
+	{
+		const detail::topology& t = detail::system_topology();
+		if (node < 0 || node >= t.nodes || CPU_COUNT(&t.cpus[node]) == 0)
+			return;
+		if (!bind_cpus(t.cpus[node]))
+			return;
+		if (policy != cpus_only)
+		{
+			unsigned long mask[detail::node_mask_words] = { 0 };
+			mask[node / (8 * sizeof(unsigned long))] = 1ul << (node % (8 * sizeof(unsigned long)));
+			if (detail::get_mempolicy(&_saved_mode, _saved_nodes) != 0
+				|| detail::set_mempolicy(policy == bind_node ? MPOL_BIND : MPOL_PREFERRED, mask) != 0)
+			{
+				::sched_setaffinity(0, sizeof(_saved_cpus), &_saved_cpus);
+				return;
+			}
+			_policy_set = true;
+		}
+		_bound = true;
+	}
+
+	explicit numa_binding(const cpu_set_t& cpus)
+		: _bound(false), _policy_set(false)
+	{
+		_bound = bind_cpus(cpus);
+	}
+
+	~numa_binding()
+	{
+		if (!_bound)
+			return;
+		if (_policy_set)
+			detail::set_mempolicy(_saved_mode, _saved_nodes);
+		::sched_setaffinity(0, sizeof(_saved_cpus), &_saved_cpus);
+	}
+
+	bool bound() const
+	{
+		return _bound;
+	}
+
+private:
+	bool bind_cpus(const cpu_set_t& cpus)
+	{
+		if (::sched_getaffinity(0, sizeof(_saved_cpus), &_saved_cpus) != 0)
+			return false;
+		return ::sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+	}
+
+	bool _bound;
+	bool _policy_set;
+	cpu_set_t _saved_cpus;
+	int _saved_mode;
+	unsigned long _saved_nodes[detail::node_mask_words];
+};
+
+#else
+
+inline int node_count()
+{
+	return 1;
+}
+
+inline int current_node()
+{
+	return -1;
+}
+
+class numa_binding
+	: noncopyable
+{
+public:
+	explicit numa_binding(int, memory_policy = prefer_node)
+	{}
+
+	bool bound() const
+	{
+		return false;
+	}
+};
+
+#endif
+
+}
+}
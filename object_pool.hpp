@@ -0,0 +1,346 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Borrowing from object pools
+=================================
+
+Introduction:
+
+	Some objects are expensive to construct and cheap to reuse: compiled
+	regular expressions, codec contexts, large scratch buffers. Instead of
+	constructing one in a scope and destroying it at the end, the scope can
+	borrow a ready-made instance from a pool and give it back on exit:
+
+		static boost::pooled_construction::object_pool<Regex> dates(64,
+			[] { return new Regex("\\d{4}-\\d{2}-\\d{2}"); });
+
+		BOOST_PREDICATED_BORROW(looksLikeDate, re, Regex, dates);
+		if (looksLikeDate)
+			re.match(text);
+
+	Like BOOST_PREDICATED_CONSTRUCTOR, nothing happens when the predicate is
+	false, and otherwise 're' is a reference to an object that is valid for
+	the rest of the scope. The difference is that construction and
+	destruction become a pop and a push.
+
+	Two kinds of pools are provided:
+
+	object_pool - shared by all threads. The idle instances live in a
+	bounded lock-free stack, so borrowing and returning never block, and
+	the most recently returned (cache-warm) instance is handed out first.
+
+	local_object_pool - no synchronization at all, for pools that are only
+	used by one thread; typically declared thread_local.
+
+	When a pool is empty a new instance is made with the factory; when it is
+	full a returned instance is deleted. To have the first borrows find a
+	ready-made instance as well, fill the pool up front with reserve():
+
+		static boost::pooled_construction::object_pool<Regex> dates(64, make_date_regex);
+		dates.reserve(16);      // e.g. at startup, one per worker thread
+
+Synopsis:
+
+	template <class T>
+	class object_pool
+	{
+		explicit object_pool(std::size_t capacity);   // new T() as factory
+		template <class Factory> object_pool(std::size_t capacity, Factory f);
+		~object_pool();
+
+		void reserve(std::size_t n);   // make n instances now, up to capacity
+		T* acquire();
+		void release(T* t);
+	};
+
+	template <class T>
+	class local_object_pool
+	{
+		// same interface
+	};
+
+	template <class T>
+	class borrowed
+	{
+		template <class Pool> explicit borrowed(Pool* pool);  // null: borrow nothing
+		T* operator -> () const;
+		T& operator * () const;
+	};
+
+	BOOST_PREDICATED_BORROW(condition, name, obj, pool)
+
+Notes:
+
+	* instances come back in whatever state the last borrower left them in;
+	clear them before use if that matters.
+
+	* a pool deletes its idle instances on destruction and must outlive
+	every borrow.
+
+	* the factory must return an object allocated with new.
+
+*/
+
+#include "predicated_construction.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/preprocessor/cat.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <vector>
+
+namespace boost {
+namespace pooled_construction {
+
+namespace detail {
+
+template <class T>
+T* default_factory()
+{
+	return new T();
+}
+
+}
+
+template <class T>
+class object_pool
+	: noncopyable
+{
+public:
+	explicit object_pool(std::size_t capacity)
+		: _factory(&detail::default_factory<T>)
+	{
+		init(capacity);
+	}
+
+	template <class Factory>
+	object_pool(std::size_t capacity, Factory f)
+		: _factory(f)
+	{
+		init(capacity);
+	}
+
+	~object_pool()
+	{
+		while (T* t = pop())
+			delete t;
+		delete[] _values;
+		delete[] _next;
+	}
+
+	void reserve(std::size_t n)
+	{
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			const boost::uint32_t slot = pop_slot(_free);
+			if (slot == nil)
+				return;
+			try
+			{
+				_values[slot] = _factory();
+			}
+			catch (...)
+			{
+				push_slot(_free, slot);
+				throw;
+			}
+			push_slot(_idle, slot);
+		}
+	}
+
+	T* acquire()
+	{
+		T* t = pop();
+		return t ? t : _factory();
+	}
+
+	void release(T* t)
+	{
+		if (!push(t))
+			delete t;
+	}
+
+private:
+	static const boost::uint32_t nil = ~boost::uint32_t(0);
+
+	void init(std::size_t capacity)
+	{
+		_values = new T*[capacity];
+		try
+		{
+			_next = new std::atomic<boost::uint32_t>[capacity];
+		}
+		catch (...)
+		{
+			delete[] _values;
+			throw;
+		}
+		_idle.store(nil, std::memory_order_relaxed);
+		_free.store(nil, std::memory_order_relaxed);
+		for (std::size_t i = 0; i < capacity; ++i)
+			push_slot(_free, boost::uint32_t(i));
+	}
+
+	bool push(T* t)
+	{
+		const boost::uint32_t slot = pop_slot(_free);
+		if (slot == nil)
+			return false;
+		_values[slot] = t;
+		push_slot(_idle, slot);
+		return true;
+	}
+
+	T* pop()
+	{
+		const boost::uint32_t slot = pop_slot(_idle);
+		if (slot == nil)
+			return 0;
+		T* t = _values[slot];
+		push_slot(_free, slot);
+		return t;
+	}
+
+	// Treiber stacks of slot indices. The upper half of a stack head is a
+	// version counter bumped on every change, which rules out ABA.
+	void push_slot(std::atomic<boost::uint64_t>& stack, boost::uint32_t slot)
+	{
+		boost::uint64_t head = stack.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			_next[slot].store(boost::uint32_t(head), std::memory_order_relaxed);
+			const boost::uint64_t replacement = (((head >> 32) + 1) << 32) | slot;
+			if (stack.compare_exchange_weak(head, replacement, std::memory_order_release, std::memory_order_relaxed))
+				return;
+		}
+	}
+
+	boost::uint32_t pop_slot(std::atomic<boost::uint64_t>& stack)
+	{
+		boost::uint64_t head = stack.load(std::memory_order_acquire);
+		for (;;)
+		{
+			const boost::uint32_t slot = boost::uint32_t(head);
+			if (slot == nil)
+				return nil;
+			const boost::uint64_t replacement = (((head >> 32) + 1) << 32) | _next[slot].load(std::memory_order_relaxed);
+			if (stack.compare_exchange_weak(head, replacement, std::memory_order_acquire, std::memory_order_acquire))
+				return slot;
+		}
+	}
+
+	std::function<T* ()> _factory;
+	T** _values;
+	std::atomic<boost::uint32_t>* _next;
+	std::atomic<boost::uint64_t> _idle;
+	std::atomic<boost::uint64_t> _free;
+};
+
+template <class T>
+class local_object_pool
+	: noncopyable
+{
+public:
+	explicit local_object_pool(std::size_t capacity)
+		: _factory(&detail::default_factory<T>), _capacity(capacity)
+	{
+		_free.reserve(capacity);
+	}
+
+	template <class Factory>
+	local_object_pool(std::size_t capacity, Factory f)
+		: _factory(f), _capacity(capacity)
+	{
+		_free.reserve(capacity);
+	}
+
+	~local_object_pool()
+	{
+		for (std::size_t i = 0; i < _free.size(); ++i)
+			delete _free[i];
+	}
+
+	void reserve(std::size_t n)
+	{
+		for (std::size_t i = 0; i < n && _free.size() < _capacity; ++i)
+			_free.push_back(_factory());
+	}
+
+	T* acquire()
+	{
+		if (_free.empty())
+			return _factory();
+		T* t = _free.back();
+		_free.pop_back();
+		return t;
+	}
+
+	void release(T* t)
+	{
+		if (_free.size() < _capacity)
+			_free.push_back(t);
+		else
+			delete t;
+	}
+
+private:
+	std::function<T* ()> _factory;
+	const std::size_t _capacity;
+	std::vector<T*> _free;
+};
+
+template <class T>
+class borrowed
+	: noncopyable
+{
+public:
+	template <class Pool>
+	explicit borrowed(Pool* pool)
+		: _pool(pool)
+		, _t(pool ? pool->acquire() : 0)
+		, _release(&release_to<Pool>)
+	{}
+
+	~borrowed()
+	{
+		if (_t)
+			_release(_pool, _t);
+	}
+
+	T* operator -> () const
+	{
+		return _t;
+	}
+
+	T& operator * () const
+	{
+		return *_t;
+	}
+
+private:
+	template <class Pool>
+	static void release_to(void* pool, T* t)
+	{
+		static_cast<Pool*>(pool)->release(t);
+	}
+
+	void* _pool;
+	T* _t;
+	void (*_release)(void*, T*);
+};
+
+}
+}
+
+#define BOOST_PREDICATED_BORROW(condition, name, obj, pool) \
+	::boost::pooled_construction::borrowed<obj> BOOST_PP_CAT(_borrowed_##obj,__LINE__)((condition) ? &(pool) : 0); \
+	obj& name = *BOOST_PP_CAT(_borrowed_##obj,__LINE__)
@@ -0,0 +1,328 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Hardware performance counter scopes
+=========================================
+
+Introduction:
+
+	Instructions per cycle, cache misses and branch mispredictions explain
+	most performance surprises, but they are usually measured in a separate
+	profiling build that never sees production data. A counter scope reads
+	the CPU's performance counters on entry and exit and adds the difference
+	to totals kept per call site. With predicated construction it is cheap
+	enough to leave in production and sample a fraction of the calls:
+
+		#include "sampled_timer.hpp"        // BOOST_SAMPLED_ONE_IN
+
+		void probe(...)
+		{
+			BOOST_PERF_COUNTER_SCOPE(BOOST_SAMPLED_ONE_IN(1000), "hash_join::probe");
+			...
+		}
+
+		boost::perf_counters::dump(std::cerr);
+
+	prints, per call site, the number of samples, cycles, instructions, IPC,
+	last level cache misses and branch misses, the latter two also per
+	thousand instructions.
+
+Synopsis:
+
+	enum event { cycles, instructions, llc_misses, branch_misses, event_count };
+
+	class call_site
+		: public site_registry::registered_site<call_site>
+	{
+		call_site(const char* name, const char* file, int line);
+
+		uint64_t samples() const;
+		uint64_t total(event e) const;
+	};
+
+	class counter_scope
+	{
+		explicit counter_scope(call_site& site);
+	};
+
+	bool available();
+	void dump(std::ostream& os);
+
+	BOOST_PERF_COUNTER_SCOPE(condition, name)
+
+Notes:
+
+	* Linux only, through perf_event_open(2). Each thread opens one event
+	group the first time it enters a sampled scope and keeps the file
+	descriptors for its lifetime; a sample costs two read() calls.
+
+	* counters count user space only (exclude_kernel, exclude_hv), so they
+	work with perf_event_paranoid up to 2.
+
+	* if the counters can't be opened (no PMU in a VM, perf_event_paranoid
+	too strict, not Linux) sentries do nothing and available() is false.
+	Events the CPU doesn't support are reported as zero.
+
+	* if the kernel multiplexes the group, deltas are scaled by the ratio
+	of enabled to running time.
+
+	* call sites have static storage duration and are registered in a
+	lock-free list on first use (see site_registry.hpp); totals are updated
+	with relaxed atomic adds, which only contend if the same site is sampled
+	on several threads at once.
+
+*/
+
+#include "predicated_construction.hpp"
+#include "site_registry.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace boost {
+namespace perf_counters {
+
+enum event
+{
+	cycles,
+	instructions,
+	llc_misses,
+	branch_misses,
+	event_count
+};
+
+namespace detail {
+
+struct reading
+{
+	uint64_t value[event_count];
+	uint64_t enabled;
+	uint64_t running;
+};
+
+#if defined(__linux__)
+
+class thread_group
+	: noncopyable
+{
+public:
+	thread_group()
+		: _leader(-1), _opened(0)
+	{
+		static const uint64_t configs[event_count] =
+		{
+			PERF_COUNT_HW_CPU_CYCLES,
+			PERF_COUNT_HW_INSTRUCTIONS,
+			PERF_COUNT_HW_CACHE_MISSES,
+			PERF_COUNT_HW_BRANCH_MISSES
+		};
+
+		for (int e = 0; e < event_count; ++e)
+			_fds[e] = -1;
+
+		for (int e = 0; e < event_count; ++e)
+		{
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = configs[e];
+			attr.disabled = _leader < 0 ? 1 : 0;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			const int fd = int(::syscall(SYS_perf_event_open, &attr, 0, -1, _leader, 0));
+			if (fd < 0)
+			{
+				if (_leader < 0)
+					return; // without cycles there's no group
+				continue;
+			}
+			if (_leader < 0)
+				_leader = fd;
+			_fds[e] = fd;
+			_slot[e] = _opened++;
+		}
+		::ioctl(_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+
+	~thread_group()
+	{
+		for (int e = event_count; e-- > 0; )
+			if (_fds[e] >= 0)
+				::close(_fds[e]);
+	}
+
+	bool valid() const
+	{
+		return _leader >= 0;
+	}
+
+	bool read(reading& r) const
+	{
+		uint64_t buf[3 + event_count];
+		const ssize_t expected = ssize_t((3 + _opened) * sizeof(uint64_t));
+		if (::read(_leader, buf, sizeof(buf)) != expected)
+			return false;
+		r.enabled = buf[1];
+		r.running = buf[2];
+		for (int e = 0; e < event_count; ++e)
+			r.value[e] = _fds[e] >= 0 ? buf[3 + _slot[e]] : 0;
+		return true;
+	}
+
+private:
+	int _leader;
+	int _fds[event_count];
+	unsigned _slot[event_count];
+	unsigned _opened;
+};
+
+#else
+
+class thread_group
+{
+public:
+	bool valid() const { return false; }
+	bool read(reading&) const { return false; }
+};
+
+#endif
+
+inline thread_group& local_group()
+{
+	static thread_local thread_group group;
+	return group;
+}
+
+}
+
+class call_site
+	: public site_registry::registered_site<call_site>
+{
+public:
+	call_site(const char* name, const char* file, int line)
+		: registered_site<call_site>(name, file, line), _samples(0)
+	{
+		for (int e = 0; e < event_count; ++e)
+			_totals[e].store(0, std::memory_order_relaxed);
+		enlist();
+	}
+
+	uint64_t samples() const
+	{
+		return _samples.load(std::memory_order_relaxed);
+	}
+
+	uint64_t total(event e) const
+	{
+		return _totals[e].load(std::memory_order_relaxed);
+	}
+
+	void add(const uint64_t (&delta)[event_count])
+	{
+		_samples.fetch_add(1, std::memory_order_relaxed);
+		for (int e = 0; e < event_count; ++e)
+			_totals[e].fetch_add(delta[e], std::memory_order_relaxed);
+	}
+
+	struct snapshot
+	{
+		explicit snapshot(const call_site& s)
+			: site(&s), samples(s.samples())
+		{
+			for (int e = 0; e < event_count; ++e)
+				total[e] = s.total(event(e));
+		}
+
+		const call_site* site;
+		uint64_t samples;
+		uint64_t total[event_count];
+	};
+
+private:
+	std::atomic<uint64_t> _samples;
+	std::atomic<uint64_t> _totals[event_count];
+};
+
+class counter_scope
+	: noncopyable
+{
+public:
+	explicit counter_scope(call_site& site)
+		: _site(site), _group(detail::local_group())
+	{
+		_valid = _group.valid() && _group.read(_start);
+	}
+
+	~counter_scope()
+	{
+		detail::reading end;
+		if (!_valid || !_group.read(end))
+			return;
+		const uint64_t enabled = end.enabled - _start.enabled;
+		const uint64_t running = end.running - _start.running;
+		uint64_t delta[event_count];
+		for (int e = 0; e < event_count; ++e)
+		{
+			delta[e] = end.value[e] - _start.value[e];
+			if (running && running < enabled)
+				delta[e] = uint64_t(double(delta[e]) * double(enabled) / double(running));
+		}
+		_site.add(delta);
+	}
+
+private:
+	call_site& _site;
+	detail::thread_group& _group;
+	detail::reading _start;
+	bool _valid;
+};
+
+// Whether the calling thread could open the counters.
+inline bool available()
+{
+	return detail::local_group().valid();
+}
+
+inline void dump(std::ostream& os)
+{
+	const std::vector<call_site::snapshot> sites = site_registry::snapshots<call_site>(&call_site::snapshot::samples);
+	for (std::size_t i = 0; i < sites.size(); ++i)
+	{
+		const call_site::snapshot& s = sites[i];
+		const double instr = double(s.total[instructions]);
+		site_registry::write_location(os, *s.site) << "samples=" << s.samples
+			<< " cycles=" << s.total[cycles]
+			<< " instructions=" << s.total[instructions]
+			<< " ipc=" << (s.total[cycles] ? instr / double(s.total[cycles]) : 0.0)
+			<< " llc_misses=" << s.total[llc_misses]
+			<< " (" << (instr ? 1000.0 * double(s.total[llc_misses]) / instr : 0.0) << "/ki)"
+			<< " branch_misses=" << s.total[branch_misses]
+			<< " (" << (instr ? 1000.0 * double(s.total[branch_misses]) / instr : 0.0) << "/ki)\n";
+	}
+}
+
+}
+}
+
+#define BOOST_PERF_COUNTER_SCOPE(condition, name) \
+	BOOST_REGISTERED_SITE_SCOPE(condition, ::boost::perf_counters::call_site, ::boost::perf_counters::counter_scope, boost_perf_counter_scope, name)
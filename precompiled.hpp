@@ -0,0 +1,67 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Precompiling custom_ops.hpp and predicated_construction.hpp
+=================================================================
+
+Introduction:
+
+	Both headers are cheap by themselves but pull in Boost.Typeof,
+	Boost.Preprocessor, MPL, TypeTraits and aligned_storage, which every
+	translation unit parses again. There are two ways to parse them once per
+	build instead.
+
+Precompiled header:
+
+	This header includes both of them and is meant to be precompiled and
+	included first by every translation unit (or forced with -include / /FI):
+
+		g++ -std=c++11 -x c++-header precompiled.hpp -o precompiled.hpp.gch
+		clang++ -std=c++11 -x c++-header precompiled.hpp -o precompiled.hpp.pch
+		cl /Yc"precompiled.hpp" ...  and  /Yu"precompiled.hpp" in the users
+
+	Put other heavy, rarely changing includes of the project next to it in
+	the project's own precompiled header rather than in this one.
+
+C++20 header units:
+
+	Named modules can't export macros, and the interface of both libraries
+	consists of macros (BOOST_CUSTOM_OP, BOOST_PREDICATED_CONSTRUCTOR, ...),
+	so there is no named module for them. Header units do carry macros, and
+	both headers are importable as such:
+
+		g++ -std=c++20 -fmodules-ts -fmodule-header -x c++-header custom_ops.hpp
+		g++ -std=c++20 -fmodules-ts -fmodule-header -x c++-header predicated_construction.hpp
+
+		import "custom_ops.hpp";
+		import "predicated_construction.hpp";
+
+	With MSVC, compile them with /exportHeader and import them the same way
+	(or translate the #includes with /translateInclude).
+
+Notes:
+
+	* configuration macros (BOOST_CUSTOM_OPS_FORCE_INLINE,
+	BOOST_PREDICATED_CONSTRUCTION_STATISTICS, BOOST_TYPEOF_EMULATION, ...)
+	take effect when the precompiled header or header unit is built, not
+	when it is used; build one per configuration.
+
+	* the other headers of the library (task_scope.hpp, scoped_arena.hpp,
+	...) include predicated_construction.hpp textually and work unchanged
+	with either.
+
+	* for the headers alone the saving per translation unit is small, but
+	it adds up over a project with thousands of them. bench/CMakeLists.txt
+	builds a translation unit all three ways (target_precompile_headers for
+	the precompiled header, a custom command per header unit), and
+	bench/build_time_precompiled.py measures them with a given compiler.
+
+*/
+
+#include "custom_ops.hpp"
+#include "predicated_construction.hpp"
@@ -58,6 +58,144 @@ BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(renderInWireframe, WireframeSentry, (devi
 If renderInWireframe is true then an unnamed object will be created and destroyed
 on scope exit. Otherwise nothing will happer (save for an 'if').
 
+When the code after it has to know whether the object exists, or pass it on,
+BOOST_PREDICATED_POINTER_CONSTRUCTOR names a pointer to it instead, null if
+the condition was false:
+
+BOOST_PREDICATED_POINTER_CONSTRUCTOR(renderInWireframe, wireframe, WireframeSentry, (device));
+drawOverlay(wireframe); // WireframeSentry*, null when solid
+
+Batches:
+
+When there are many objects to create conditionally - one sentry per entity,
+say - a bit mask can stand in for the individual predicates:
+
+Entity* entities[256];
+boost::uint64_t selected[4] = ...; // bit i set => construct a sentry for entities[i]
+BOOST_PREDICATED_BATCH_CONSTRUCTOR(selected, sentries, EntitySentry, 256, i, (entities[i]));
+
+The sentries live in one contiguous, properly aligned array. Only the set bits
+are visited, both on construction (in ascending order) and on destruction (in
+descending order, mirroring scope exit). sentries[i] is the i-th object and
+sentries.contains(i) tells whether it was constructed. For up to 64 objects
+the mask may also be a single boost::uint64_t.
+
+Lazy construction:
+
+Sometimes the predicate is not known up front but is simply "the object is
+needed". BOOST_LAZY_CONSTRUCTOR reserves the storage the same way, but
+constructs the object only when it is first accessed:
+
+BOOST_LAZY_CONSTRUCTOR(index, ScratchIndex, (records, options));
+...
+if (rareCondition)
+	index->lookup(key); // ScratchIndex is constructed here, once
+
+The object is destroyed on scope exit only if it was ever constructed. Note
+that the constructor arguments are captured by reference and evaluated at the
+point of first access, not at the point of declaration. 'index' behaves like
+a pointer (->, *); index.constructed() tells whether it has been built yet.
+Lazy construction requires C++11 lambdas.
+
+Sticky construction:
+
+Inside a loop whose predicate rarely changes, BOOST_PREDICATED_CONSTRUCTOR
+would create and destroy the sentry on every iteration - for WireframeSentry
+that's two device calls per draw. A sticky sentry is declared outside of the
+loop and follows the predicate, reconstructing only when its value changes:
+
+BOOST_STICKY_CONSTRUCTOR(wireframe, WireframeSentry);
+for (...)
+{
+	BOOST_STICKY_UPDATE(object.wireframe, wireframe, (device));
+	object.draw();
+}
+
+BOOST_STICKY_UPDATE constructs the object when the predicate becomes true and
+destroys it when it becomes false; while the predicate stays the same it does
+nothing (save for a comparison). Whatever is left is destroyed on exit from
+the scope of the declaration. Note that changed constructor arguments alone
+don't trigger reconstruction; call wireframe.reset() to force it.
+wireframe.reset(), wireframe.armed() and, with C++11, wireframe.emplace(...)
+can also be used directly, and the object is reachable through -> and *.
+BOOST_STICKY_UPDATE takes the type to construct from the declaration, so it
+can't disagree with the storage; it requires C++11 decltype.
+
+Reentrant construction:
+
+Recursive code tends to apply the same sentry at every level of recursion.
+With
+
+BOOST_REENTRANT_CONSTRUCTOR(WireframeSentry, (device));
+
+only the outermost WireframeSentry on the current thread is actually
+constructed; nested ones merely bump a thread-local depth counter. The object
+is destroyed when the outermost scope is left.
+BOOST_PREDICATED_REENTRANT_CONSTRUCTOR(condition, obj, params) combines this
+with a predicate - scopes where it's false neither construct nor count. The
+depth is tracked per type, not per constructor arguments, so nested sentries
+of the same type are assumed to have the same effect. Requires C++11
+thread_local.
+
+Code generation:
+
+With optimization, BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR compiles to the
+equivalent of writing the condition out twice (the compiler may lay the two
+paths out separately instead of testing the condition again),
+
+	if (renderInWireframe) enable_wireframe(device);
+	...
+	if (renderInWireframe) disable_wireframe(device);
+
+plus a landing pad that runs the destructor if the scope is left by an
+exception. The storage object is forced inline, and its pointer lives in a
+register, not behind a load from the stack frame. tests/codegen checks this
+on x86-64 after a compiler upgrade: it compiles a sentry function next to its
+hand-written equivalent with -O2 and fails on calls other than the
+constructor's, the destructor's and the scope's own, or on stack accesses the
+hand-written version doesn't make. Elsewhere compare the hot paths in the
+disassembly (objdump -d -C, dumpbin /disasm) by hand.
+
+Alternatives:
+
+The same thing can be done with std::optional<T> (emplace under the
+condition), std::unique_ptr<T> (new under the condition), a 'bool enable'
+constructor parameter, or by duplicating the scope in both branches of an
+if. Once the sentry's constructor and destructor are inlined, all of them
+compile to one test on entry and one on exit; what differs is:
+
+	* stack: predicated construction and optional reserve sizeof(T) whether
+	or not the object is made; optional adds a flag, which the predicated
+	storage doesn't need because its pointer doubles as the flag and lives in a
+	register. unique_ptr reserves a pointer but pays for an allocation
+	(unless the compiler elides the new/delete pair). The flag parameter
+	needs a modified T and stores the flag in every object.
+
+	* code size: duplicating the scope doubles the scope's code; the others
+	are within a few bytes of each other.
+
+	* branch layout: the compiler lays out the constructing path of the
+	predicated macros as the fall-through, which costs a taken branch per
+	scope when the condition is almost always false. For such predicates
+	state it in the condition (GCC/Clang):
+
+		BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(__builtin_expect(debugDraw, 0), WireframeSentry, (device));
+
+	or build with profile feedback; the statistics mode below tells which
+	sites are such.
+
+bench/predicated_alternatives_bench.cpp times the five forms for conditions
+true 0%, 1%, 50% and 100% of the time, with branch misses where hardware
+counters are available; bench/predicated_alternatives_size.py reports their
+stack use (-fstack-usage) and code size.
+
+Statistics:
+
+Defining BOOST_PREDICATED_CONSTRUCTION_STATISTICS before including this header
+makes BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR and BOOST_PREDICATED_CONSTRUCTOR
+count how often each site's condition was true and false. See
+predicated_statistics.hpp for the report.
+
 
 */
 
@@ -68,8 +206,19 @@ on scope exit. Otherwise nothing will happer (save for an 'if').
 
 #pragma once
 
+#include <boost/config.hpp>
 #include <boost/type_traits/alignment_of.hpp>
+#include <boost/type_traits/remove_reference.hpp>
 #include <boost/aligned_storage.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/static_assert.hpp>
+
+#include <cstddef>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace boost {
 namespace detail {
@@ -77,16 +226,145 @@ namespace detail {
 template <class T>
 struct predicated_constructee_storage
 {
-	predicated_constructee_storage(T* t)
+	BOOST_FORCEINLINE predicated_constructee_storage(T* t)
 		: _t(t)
 	{}
 
-	~predicated_constructee_storage()
+	BOOST_FORCEINLINE ~predicated_constructee_storage()
+	{
+		if (_t)
+			_t->~T();
+	}
+
+	BOOST_FORCEINLINE T* operator -> () const
+	{
+		return _t;
+	}
+
+	BOOST_FORCEINLINE T& operator * () const
+	{
+		return *_t;
+	}
+
+private:
+	T* _t;
+};
+
+template <class T>
+struct lazy_constructee_storage
+{
+	template <class Factory>
+	lazy_constructee_storage(void* mem, Factory& factory)
+		: _t(0)
+		, _mem(mem)
+		, _factory(&factory)
+		, _make(&make<Factory>)
+	{}
+
+	~lazy_constructee_storage()
 	{
 		if (_t)
 			_t->~T();
 	}
 
+	bool constructed() const
+	{
+		return _t != 0;
+	}
+
+	T* get()
+	{
+		if (!_t)
+			_t = _make(_mem, _factory);
+		return _t;
+	}
+
+	T* operator -> ()
+	{
+		return get();
+	}
+
+	T& operator * ()
+	{
+		return *get();
+	}
+
+private:
+	lazy_constructee_storage(const lazy_constructee_storage&);
+	lazy_constructee_storage& operator = (const lazy_constructee_storage&);
+
+	template <class Factory>
+	static T* make(void* mem, void* factory)
+	{
+		return (*static_cast<Factory*>(factory))(mem);
+	}
+
+	T* _t;
+	void* _mem;
+	void* _factory;
+	T* (*_make)(void*, void*);
+};
+
+template <class T>
+struct sticky_constructee_storage
+{
+	typedef T value_type;
+
+	sticky_constructee_storage()
+		: _t(0)
+	{}
+
+	~sticky_constructee_storage()
+	{
+		reset();
+	}
+
+	bool armed() const
+	{
+		return _t != 0;
+	}
+
+	// Destroys the object if the predicate became false; returns true if
+	// it became true and the caller should construct the object.
+	bool update(bool condition)
+	{
+		if (condition == armed())
+			return false;
+		if (!condition)
+			reset();
+		return condition;
+	}
+
+	void reset()
+	{
+		if (_t)
+		{
+			T* t = _t;
+			_t = 0;
+			t->~T();
+		}
+	}
+
+	void* slot()
+	{
+		return &_mem;
+	}
+
+	void commit(T* t)
+	{
+		_t = t;
+	}
+
+#if !defined(BOOST_NO_CXX11_VARIADIC_TEMPLATES) && !defined(BOOST_NO_CXX11_RVALUE_REFERENCES)
+	template <class... Args>
+	T& emplace(Args&&... args)
+	{
+		reset();
+		_t = new (slot()) T(static_cast<Args&&>(args)...);
+		return *_t;
+	}
+#endif
+
 	T* operator -> () const
 	{
 		return _t;
@@ -98,26 +376,257 @@ struct predicated_constructee_storage
 	}
 
 private:
+	sticky_constructee_storage(const sticky_constructee_storage&);
+	sticky_constructee_storage& operator = (const sticky_constructee_storage&);
+
+	typename ::boost::aligned_storage<
+		sizeof(T), ::boost::alignment_of<T>::value
+	>::type _mem;
 	T* _t;
 };
 
+#if !defined(BOOST_NO_CXX11_THREAD_LOCAL)
+
+template <class T>
+struct reentrancy_counter
+{
+	explicit reentrancy_counter(bool condition)
+		: _counted(condition)
+	{
+		if (_counted)
+			++depth();
+	}
+
+	~reentrancy_counter()
+	{
+		if (_counted)
+			--depth();
+	}
+
+	bool outermost() const
+	{
+		return _counted && depth() == 1;
+	}
+
+private:
+	reentrancy_counter(const reentrancy_counter&);
+	reentrancy_counter& operator = (const reentrancy_counter&);
+
+	static unsigned& depth()
+	{
+		static thread_local unsigned d = 0;
+		return d;
+	}
+
+	const bool _counted;
+};
+
+#endif
+
+inline unsigned predicated_lowest_bit(boost::uint64_t v)
+{
+#if defined(_MSC_VER)
+	unsigned long r;
+	_BitScanForward64(&r, v);
+	return r;
+#else
+	return __builtin_ctzll(v);
+#endif
+}
+
+inline unsigned predicated_highest_bit(boost::uint64_t v)
+{
+#if defined(_MSC_VER)
+	unsigned long r;
+	_BitScanReverse64(&r, v);
+	return r;
+#else
+	return 63 - __builtin_clzll(v);
+#endif
+}
+
+template <class T, std::size_t N>
+struct predicated_constructee_batch
+{
+	static const std::size_t word_count = (N + 63) / 64;
+
+	predicated_constructee_batch(const boost::uint64_t* mask)
+	{
+		for (std::size_t w = 0; w < word_count; ++w)
+		{
+			_pending[w] = mask[w];
+			_live[w] = 0;
+		}
+		trim();
+	}
+
+	predicated_constructee_batch(boost::uint64_t mask)
+	{
+		BOOST_STATIC_ASSERT(N <= 64);
+		_pending[0] = mask;
+		_live[0] = 0;
+		trim();
+	}
+
+	~predicated_constructee_batch()
+	{
+		for (std::size_t w = word_count; w-- > 0; )
+		{
+			for (boost::uint64_t bits = _live[w]; bits; )
+			{
+				const unsigned b = predicated_highest_bit(bits);
+				bits &= ~(boost::uint64_t(1) << b);
+				(*this)[w * 64 + b].~T();
+			}
+		}
+	}
+
+	// Index of the first object to construct, N if none.
+	std::size_t first_pending() const
+	{
+		return find_pending(0);
+	}
+
+	// Index of the next object to construct after i, N if none.
+	std::size_t next_pending(std::size_t i) const
+	{
+		return find_pending(i + 1);
+	}
+
+	void* slot(std::size_t i)
+	{
+		return static_cast<T*>(static_cast<void*>(&_mem)) + i;
+	}
+
+	// Records that the object at index i has been constructed.
+	void commit(std::size_t i, T*)
+	{
+		_live[i / 64] |= boost::uint64_t(1) << (i % 64);
+	}
+
+	bool contains(std::size_t i) const
+	{
+		return (_live[i / 64] >> (i % 64)) & 1;
+	}
+
+	T& operator [] (std::size_t i)
+	{
+		return *static_cast<T*>(slot(i));
+	}
+
+private:
+	predicated_constructee_batch(const predicated_constructee_batch&);
+	predicated_constructee_batch& operator = (const predicated_constructee_batch&);
+
+	void trim()
+	{
+		if (N % 64)
+			_pending[word_count - 1] &= (boost::uint64_t(1) << (N % 64)) - 1;
+	}
+
+	std::size_t find_pending(std::size_t from) const
+	{
+		std::size_t w = from / 64;
+		if (w >= word_count)
+			return N;
+		boost::uint64_t bits = (from % 64) ? _pending[w] & (~boost::uint64_t(0) << (from % 64)) : _pending[w];
+		for (;;)
+		{
+			if (bits)
+				return w * 64 + predicated_lowest_bit(bits);
+			if (++w == word_count)
+				return N;
+			bits = _pending[w];
+		}
+	}
+
+	typename ::boost::aligned_storage<
+		sizeof(T) * N, ::boost::alignment_of<T>::value
+	>::type _mem;
+	boost::uint64_t _pending[word_count];
+	boost::uint64_t _live[word_count];
+};
+
 }
 }
 
 #include <boost/preprocessor/cat.hpp>
 
+#if defined(BOOST_PREDICATED_CONSTRUCTION_STATISTICS)
+
+#include "predicated_statistics.hpp"
+
+#define BOOST_PREDICATED_SITE(obj) \
+	static ::boost::predicated_statistics::site BOOST_PP_CAT(_site_##obj,__LINE__)(#obj, __FILE__, __LINE__, sizeof(BOOST_PP_CAT(_mem_##obj,__LINE__)));
+
+#define BOOST_PREDICATED_SITE_CONDITION(condition, obj) \
+	BOOST_PP_CAT(_site_##obj,__LINE__).record((condition) ? true : false)
+
+#else
+
+#define BOOST_PREDICATED_SITE(obj)
+
+#define BOOST_PREDICATED_SITE_CONDITION(condition, obj) \
+	(condition)
+
+#endif
+
 #define BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(condition, obj, params) \
 	::boost::aligned_storage< \
 		sizeof(obj), ::boost::alignment_of<obj>::value \
 	>::type BOOST_PP_CAT(_mem_##obj,__LINE__); \
-	::boost::detail::predicated_constructee_storage<obj> BOOST_PP_CAT(_storage_##obj,__LINE__)((condition) ? new (&BOOST_PP_CAT(_mem_##obj,__LINE__)) obj params : 0)
+	BOOST_PREDICATED_SITE(obj) \
+	::boost::detail::predicated_constructee_storage<obj> BOOST_PP_CAT(_storage_##obj,__LINE__)(BOOST_PREDICATED_SITE_CONDITION(condition, obj) ? new (&BOOST_PP_CAT(_mem_##obj,__LINE__)) obj params : 0)
 
 #define BOOST_PREDICATED_CONSTRUCTOR(condition, name, obj, params) \
 	::boost::aligned_storage< \
 		sizeof(obj), ::boost::alignment_of<obj>::value \
 	>::type BOOST_PP_CAT(_mem_##obj,__LINE__); \
-	::boost::detail::predicated_constructee_storage<obj> BOOST_PP_CAT(_storage_##obj,__LINE__)((condition) ? new (&BOOST_PP_CAT(_mem_##obj,__LINE__)) obj params : 0); \
+	BOOST_PREDICATED_SITE(obj) \
+	::boost::detail::predicated_constructee_storage<obj> BOOST_PP_CAT(_storage_##obj,__LINE__)(BOOST_PREDICATED_SITE_CONDITION(condition, obj) ? new (&BOOST_PP_CAT(_mem_##obj,__LINE__)) obj params : 0); \
 	obj& name = *BOOST_PP_CAT(_storage_##obj,__LINE__)
 
+#define BOOST_PREDICATED_POINTER_CONSTRUCTOR(condition, name, obj, params) \
+	BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(condition, obj, params); \
+	obj* const name = BOOST_PP_CAT(_storage_##obj,__LINE__).operator -> ()
+
 #define BOOST_ANONYMOUS_CONSTRUCTOR(obj, params) \
 	obj BOOST_PP_CAT(anonymous##obj,__LINE__) params;
+
+#define BOOST_PREDICATED_BATCH_CONSTRUCTOR(mask, name, obj, count, index, params) \
+	::boost::detail::predicated_constructee_batch<obj, count> name(mask); \
+	for (::std::size_t index = name.first_pending(); index < (count); index = name.next_pending(index)) \
+		name.commit(index, new (name.slot(index)) obj params)
+
+#define BOOST_STICKY_CONSTRUCTOR(name, obj) \
+	::boost::detail::sticky_constructee_storage<obj> name
+
+#if !defined(BOOST_NO_CXX11_DECLTYPE)
+
+#define BOOST_STICKY_UPDATE(condition, name, params) \
+	if (!(name).update(condition)) ; else (name).commit(new ((name).slot()) \
+		typename ::boost::remove_reference<decltype(name)>::type::value_type params)
+
+#endif
+
+#if !defined(BOOST_NO_CXX11_THREAD_LOCAL)
+
+#define BOOST_PREDICATED_REENTRANT_CONSTRUCTOR(condition, obj, params) \
+	::boost::detail::reentrancy_counter<obj> BOOST_PP_CAT(_depth_##obj,__LINE__)(condition); \
+	BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(BOOST_PP_CAT(_depth_##obj,__LINE__).outermost(), obj, params)
+
+#define BOOST_REENTRANT_CONSTRUCTOR(obj, params) \
+	BOOST_PREDICATED_REENTRANT_CONSTRUCTOR(true, obj, params)
+
+#endif
+
+#if !defined(BOOST_NO_CXX11_LAMBDAS) && !defined(BOOST_NO_CXX11_AUTO_DECLARATIONS)
+
+#define BOOST_LAZY_CONSTRUCTOR(name, obj, params) \
+	::boost::aligned_storage< \
+		sizeof(obj), ::boost::alignment_of<obj>::value \
+	>::type BOOST_PP_CAT(_mem_##obj,__LINE__); \
+	auto BOOST_PP_CAT(_factory_##obj,__LINE__) = [&](void* mem) { return new (mem) obj params; }; \
+	::boost::detail::lazy_constructee_storage<obj> name(&BOOST_PP_CAT(_mem_##obj,__LINE__), BOOST_PP_CAT(_factory_##obj,__LINE__))
+
+#endif
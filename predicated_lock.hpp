@@ -0,0 +1,201 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Predicated locking
+========================
+
+Introduction:
+
+	Code that is shared between a single-threaded and a multi-threaded mode
+	has to lock in the latter and would rather not in the former. With
+	predicated construction the lock guard itself becomes optional:
+
+		static boost::predicated_locking::adaptive_mutex cache_mutex;
+
+		void insert(...)
+		{
+			BOOST_PREDICATED_LOCK(multiThreadedMode, cache_mutex);
+			...
+		}
+
+	In single-threaded mode no guard is constructed and the mutex is never
+	touched, not even with an uncontended atomic operation.
+
+	adaptive_mutex is a small mutex for short critical sections. An
+	uncontended lock and unlock cost one atomic instruction each. Under
+	contention it spins for a bounded number of iterations, hoping the owner
+	is about to leave, and only then parks the thread in the kernel (a futex
+	on Linux), so that long waits don't burn CPU.
+
+Synopsis:
+
+	class adaptive_mutex
+	{
+		adaptive_mutex();
+
+		void lock();
+		bool try_lock();
+		void unlock();
+
+		class scoped_lock;
+	};
+
+	BOOST_PREDICATED_LOCK(condition, mutex)
+
+	The named form is simply predicated construction of the scoped lock:
+
+		typedef boost::predicated_locking::adaptive_mutex::scoped_lock Lock;
+		BOOST_PREDICATED_CONSTRUCTOR(multiThreadedMode, lock, Lock, (cache_mutex));
+
+Notes:
+
+	* the spin count is BOOST_ADAPTIVE_MUTEX_SPIN_COUNT iterations of a
+	pause instruction.
+
+	* on platforms other than Linux there is no futex; a parked thread
+	yields its time slice in a loop instead.
+
+	* adaptive_mutex satisfies the Lockable concept, so it works with
+	boost::lock_guard, std::unique_lock and friends as well.
+
+	* the mutex is neither recursive nor fair.
+
+	* the mode predicate must not change while a scope that might have
+	taken the lock is active on another thread; that is, switch modes only
+	while the program is single-threaded.
+
+*/
+
+#include "predicated_construction.hpp"
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <new>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <thread>
+#endif
+
+#ifndef BOOST_ADAPTIVE_MUTEX_SPIN_COUNT
+#define BOOST_ADAPTIVE_MUTEX_SPIN_COUNT 100
+#endif
+
+namespace boost {
+namespace predicated_locking {
+
+namespace detail {
+
+inline void cpu_relax()
+{
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	__builtin_ia32_pause();
+#elif defined(__GNUC__) && defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+#if defined(__linux__)
+
+inline void park(std::atomic<int>& word, int expected)
+{
+	::syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAIT_PRIVATE, expected, 0, 0, 0);
+}
+
+inline void unpark_one(std::atomic<int>& word)
+{
+	::syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+}
+
+#else
+
+inline void park(std::atomic<int>& word, int expected)
+{
+	if (word.load(std::memory_order_relaxed) == expected)
+		std::this_thread::yield();
+}
+
+inline void unpark_one(std::atomic<int>&)
+{}
+
+#endif
+
+}
+
+class adaptive_mutex
+	: noncopyable
+{
+public:
+	class scoped_lock
+		: noncopyable
+	{
+	public:
+		explicit scoped_lock(adaptive_mutex& m)
+			: _m(m)
+		{
+			_m.lock();
+		}
+
+		~scoped_lock()
+		{
+			_m.unlock();
+		}
+
+	private:
+		adaptive_mutex& _m;
+	};
+
+	adaptive_mutex()
+		: _state(unlocked)
+	{}
+
+	bool try_lock()
+	{
+		int expected = unlocked;
+		return _state.compare_exchange_strong(expected, locked, std::memory_order_acquire, std::memory_order_relaxed);
+	}
+
+	void lock()
+	{
+		if (try_lock())
+			return;
+
+		for (int i = 0; i < BOOST_ADAPTIVE_MUTEX_SPIN_COUNT; ++i)
+		{
+			detail::cpu_relax();
+			if (_state.load(std::memory_order_relaxed) == unlocked && try_lock())
+				return;
+		}
+
+		// Announce a waiter, so that unlock() knows it has to wake someone.
+		while (_state.exchange(contended, std::memory_order_acquire) != unlocked)
+			detail::park(_state, contended);
+	}
+
+	void unlock()
+	{
+		if (_state.exchange(unlocked, std::memory_order_release) == contended)
+			detail::unpark_one(_state);
+	}
+
+private:
+	enum { unlocked, locked, contended };
+
+	std::atomic<int> _state;
+};
+
+}
+}
+
+#define BOOST_PREDICATED_LOCK(condition, mutex) \
+	typedef ::boost::predicated_locking::adaptive_mutex::scoped_lock boost_adaptive_mutex_scoped_lock; \
+	BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(condition, boost_adaptive_mutex_scoped_lock, (mutex))
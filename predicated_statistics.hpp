@@ -0,0 +1,154 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Predicate statistics for predicated construction
+======================================================
+
+Introduction:
+
+	Whether a predicated sentry is worth its branch and its stack space
+	depends on how its predicate behaves at run time, which is hard to guess
+	from the source. Compiling with
+
+		#define BOOST_PREDICATED_CONSTRUCTION_STATISTICS
+
+	(before the first include of predicated_construction.hpp, or on the
+	command line) makes every BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR and
+	BOOST_PREDICATED_CONSTRUCTOR count, per __FILE__/__LINE__, how often its
+	condition was true and how often it was false. The report
+
+		boost::predicated_statistics::dump(std::cerr);
+
+	lists the sites sorted by evaluation count, with the true rate, the stack
+	bytes each evaluation reserves and the bytes reserved in vain (false
+	evaluations times the reservation).
+
+	Without the macro the predicated macros expand exactly as before and this
+	header isn't included.
+
+Synopsis:
+
+	class site
+		: public site_registry::registered_site<site>
+	{
+		site(const char* type, const char* file, int line, std::size_t reserved);
+
+		bool record(bool condition);
+
+		uint64_t true_count() const;
+		uint64_t false_count() const;
+		std::size_t reserved_bytes() const;     // per evaluation
+	};
+
+	void dump(std::ostream& os);
+
+Notes:
+
+	* reading the report: a site that is always true or always false is a
+	candidate for a plain local or a compile-time condition; a site whose
+	predicate is loop-invariant with a high evaluation count should be hoisted
+	or made sticky (BOOST_STICKY_CONSTRUCTOR); a large type that's rarely
+	constructed wastes stack and may be better off lazy or on the heap.
+
+	* the macros built on BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR (reentrant
+	construction, the sentries in the other headers) are counted too, under
+	the name of the type they construct. Batch, sticky and lazy construction
+	are not instrumented.
+
+	* a reentrant site counts whether it actually constructed the object
+	(outermost()), not the caller's condition: a scope whose condition is
+	true but that is nested in another one on the same thread counts as
+	false.
+
+	* counters are relaxed atomic increments on a function-local static per
+	site (see site_registry.hpp): cheap, but they contend when a site is
+	hot on several threads, so this is a profiling mode rather than
+	something to ship.
+
+	* requires C++11 (atomics and thread-safe initialization of the site
+	records).
+
+*/
+
+#include "site_registry.hpp"
+
+#include <boost/cstdint.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+namespace boost {
+namespace predicated_statistics {
+
+class site
+	: public site_registry::registered_site<site>
+{
+public:
+	site(const char* type, const char* file, int line, std::size_t reserved)
+		: registered_site<site>(type, file, line), _reserved(reserved), _true(0), _false(0)
+	{
+		enlist();
+	}
+
+	bool record(bool condition)
+	{
+		(condition ? _true : _false).fetch_add(1, std::memory_order_relaxed);
+		return condition;
+	}
+
+	const char* type() const { return name(); }
+	std::size_t reserved_bytes() const { return _reserved; }
+
+	uint64_t true_count() const { return _true.load(std::memory_order_relaxed); }
+	uint64_t false_count() const { return _false.load(std::memory_order_relaxed); }
+
+	uint64_t evaluations() const
+	{
+		return true_count() + false_count();
+	}
+
+	struct snapshot
+	{
+		explicit snapshot(const predicated_statistics::site& s)
+			: site(&s), true_count(s.true_count()), false_count(s.false_count())
+			, evaluations(true_count + false_count)
+		{}
+
+		const predicated_statistics::site* site;
+		uint64_t true_count;
+		uint64_t false_count;
+		uint64_t evaluations;
+	};
+
+private:
+	const std::size_t _reserved;
+	std::atomic<uint64_t> _true;
+	std::atomic<uint64_t> _false;
+};
+
+inline void dump(std::ostream& os)
+{
+	std::vector<site::snapshot> sites = site_registry::snapshots<site>(&site::snapshot::evaluations);
+	site_registry::sort_descending(sites, &site::snapshot::evaluations);
+	for (std::size_t i = 0; i < sites.size(); ++i)
+	{
+		const site::snapshot& s = sites[i];
+		const uint64_t reserved = s.site->reserved_bytes();
+		site_registry::write_location(os, *s.site) << "evaluations=" << s.evaluations
+			<< " true=" << s.true_count
+			<< " false=" << s.false_count
+			<< " (" << 100.0 * double(s.true_count) / double(s.evaluations) << "% true)"
+			<< " reserved=" << reserved
+			<< " unused_bytes=" << s.false_count * reserved << '\n';
+	}
+}
+
+}
+}
@@ -0,0 +1,391 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Sampled scope timers
+==========================
+
+Introduction:
+
+	Timing every execution of a hot scope is expensive: two clock reads and
+	a histogram update per call add up quickly. Most of the time a sample
+	is just as good, and predicated construction lets us pay for the timer
+	only when the sample is actually taken:
+
+		static boost::sampled_timing::latency_recorder parse_latency("parse");
+
+		void parse(...)
+		{
+			BOOST_SAMPLED_SCOPE_TIMER(BOOST_SAMPLED_ONE_IN(64), parse_latency);
+			...
+		}
+
+	When the predicate is false the cost is a decrement of a thread-local
+	counter private to the call site and an 'if'. When it is true a
+	scoped_timer is constructed in place and on scope exit records the
+	elapsed time in the calling thread's histogram.
+
+	Every thread owns a private histogram per recorder, so recording
+	never takes a lock and never touches a cache line shared with other
+	threads. Histograms are registered with their recorder on first use and
+	can be merged and dumped from any thread at any time.
+
+Synopsis:
+
+	class latency_histogram
+	{
+		void record(uint64_t nanoseconds);
+		void merge(const latency_histogram& other);
+
+		uint64_t count() const;
+		uint64_t min() const;
+		uint64_t max() const;
+		double mean() const;
+		uint64_t value_at_percentile(double percentile) const;
+	};
+
+	class latency_recorder
+	{
+		explicit latency_recorder(const char* name);
+
+		latency_histogram& local();
+		void merge_into(latency_histogram& out) const;
+		void dump(std::ostream& os) const;
+	};
+
+	class scoped_timer
+	{
+		explicit scoped_timer(latency_recorder& recorder);
+	};
+
+	bool with_probability(double p);
+
+	BOOST_SAMPLED_ONE_IN(n)
+	BOOST_SAMPLED_SCOPE_TIMER(condition, recorder)
+
+Notes:
+
+	* latency_histogram is log-linear (HDR-style): values are bucketed by
+	their highest set bit and then linearly by the next
+	BOOST_SAMPLED_TIMING_SUB_BUCKET_BITS bits, giving a constant relative
+	error (about 6% with the default of 4) from nanoseconds to centuries.
+
+	* a histogram has a single writer - the thread that owns it. Counters
+	are updated with relaxed loads and stores rather than read-modify-write
+	instructions, which is enough for concurrent readers to see a consistent
+	(if slightly stale) picture.
+
+	* recorders are meant to have static storage duration. A thread's
+	histogram outlives the thread so its samples still show up in dumps;
+	all histograms are released when the recorder is destroyed.
+
+	* at most BOOST_SAMPLED_TIMING_MAX_RECORDERS recorders may exist in a
+	program. Constructing more throws std::length_error.
+
+	* BOOST_SAMPLED_ONE_IN(n) is true once every n evaluations of that
+	particular expression on the calling thread: every expansion has its own
+	thread-local countdown, so call sites sample at their own rate no matter
+	how they interleave. with_probability() draws from a thread-local
+	generator shared by all call sites, which doesn't bias any of them.
+	Neither ever synchronizes.
+
+*/
+
+#include "predicated_construction.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+
+#ifndef BOOST_SAMPLED_TIMING_SUB_BUCKET_BITS
+#define BOOST_SAMPLED_TIMING_SUB_BUCKET_BITS 4
+#endif
+
+#ifndef BOOST_SAMPLED_TIMING_MAX_RECORDERS
+#define BOOST_SAMPLED_TIMING_MAX_RECORDERS 64
+#endif
+
+namespace boost {
+namespace sampled_timing {
+
+namespace detail {
+
+inline unsigned highest_bit(uint64_t v)
+{
+#if defined(__GNUC__)
+	return 63 - __builtin_clzll(v);
+#else
+	unsigned r = 0;
+	while (v >>= 1)
+		++r;
+	return r;
+#endif
+}
+
+}
+
+class latency_histogram
+	: noncopyable
+{
+public:
+	static const unsigned sub_bucket_bits = BOOST_SAMPLED_TIMING_SUB_BUCKET_BITS;
+	static const unsigned sub_bucket_count = 1u << sub_bucket_bits;
+	static const unsigned bucket_count = (64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+	latency_histogram()
+		: _count(0), _sum(0), _min(~uint64_t(0)), _max(0)
+	{
+		for (unsigned i = 0; i < bucket_count; ++i)
+			_buckets[i].store(0, std::memory_order_relaxed);
+	}
+
+	static unsigned bucket_index(uint64_t v)
+	{
+		if (v < sub_bucket_count)
+			return unsigned(v);
+		const unsigned msb = detail::highest_bit(v);
+		const unsigned shift = msb - sub_bucket_bits;
+		return (shift + 1) * sub_bucket_count + unsigned((v >> shift) & (sub_bucket_count - 1));
+	}
+
+	static uint64_t bucket_lower_bound(unsigned index)
+	{
+		if (index < sub_bucket_count)
+			return index;
+		const unsigned shift = index / sub_bucket_count - 1;
+		return uint64_t(sub_bucket_count + index % sub_bucket_count) << shift;
+	}
+
+	static uint64_t bucket_upper_bound(unsigned index)
+	{
+		if (index < sub_bucket_count)
+			return index;
+		const unsigned shift = index / sub_bucket_count - 1;
+		return bucket_lower_bound(index) + ((uint64_t(1) << shift) - 1);
+	}
+
+	// Only the owning thread may call record().
+	void record(uint64_t v)
+	{
+		bump(_buckets[bucket_index(v)], 1);
+		bump(_count, 1);
+		bump(_sum, v);
+		if (v < _min.load(std::memory_order_relaxed))
+			_min.store(v, std::memory_order_relaxed);
+		if (v > _max.load(std::memory_order_relaxed))
+			_max.store(v, std::memory_order_relaxed);
+	}
+
+	// Adds the contents of 'other' to this histogram. 'this' must not be
+	// concurrently written to; 'other' may be.
+	void merge(const latency_histogram& other)
+	{
+		for (unsigned i = 0; i < bucket_count; ++i)
+			bump(_buckets[i], other._buckets[i].load(std::memory_order_relaxed));
+		bump(_count, other._count.load(std::memory_order_relaxed));
+		bump(_sum, other._sum.load(std::memory_order_relaxed));
+		if (other.min() < min())
+			_min.store(other.min(), std::memory_order_relaxed);
+		if (other.max() > max())
+			_max.store(other.max(), std::memory_order_relaxed);
+	}
+
+	uint64_t count() const { return _count.load(std::memory_order_relaxed); }
+	uint64_t min() const { return _min.load(std::memory_order_relaxed); }
+	uint64_t max() const { return _max.load(std::memory_order_relaxed); }
+
+	double mean() const
+	{
+		const uint64_t n = count();
+		return n ? double(_sum.load(std::memory_order_relaxed)) / double(n) : 0.0;
+	}
+
+	// Returns the upper bound of the bucket containing the given percentile
+	// (0-100), clamped to the observed maximum.
+	uint64_t value_at_percentile(double percentile) const
+	{
+		const uint64_t n = count();
+		if (!n)
+			return 0;
+		uint64_t rank = uint64_t(percentile / 100.0 * double(n) + 0.5);
+		if (rank < 1)
+			rank = 1;
+		uint64_t seen = 0;
+		for (unsigned i = 0; i < bucket_count; ++i)
+		{
+			seen += _buckets[i].load(std::memory_order_relaxed);
+			if (seen >= rank)
+			{
+				const uint64_t v = bucket_upper_bound(i);
+				return v < max() ? v : max();
+			}
+		}
+		return max();
+	}
+
+private:
+	static void bump(std::atomic<uint64_t>& a, uint64_t by)
+	{
+		a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+	}
+
+	std::atomic<uint64_t> _buckets[bucket_count];
+	std::atomic<uint64_t> _count;
+	std::atomic<uint64_t> _sum;
+	std::atomic<uint64_t> _min;
+	std::atomic<uint64_t> _max;
+};
+
+class latency_recorder
+	: noncopyable
+{
+public:
+	explicit latency_recorder(const char* name)
+		: _name(name), _slot(next_slot()), _head(0)
+	{}
+
+	~latency_recorder()
+	{
+		node* n = _head.load(std::memory_order_acquire);
+		while (n)
+		{
+			node* next = n->next;
+			delete n;
+			n = next;
+		}
+	}
+
+	const char* name() const { return _name; }
+
+	// The calling thread's histogram for this recorder.
+	latency_histogram& local()
+	{
+		latency_histogram*& h = thread_slots()[_slot];
+		if (!h)
+			h = &register_thread();
+		return *h;
+	}
+
+	void merge_into(latency_histogram& out) const
+	{
+		for (node* n = _head.load(std::memory_order_acquire); n; n = n->next)
+			out.merge(n->histogram);
+	}
+
+	void dump(std::ostream& os) const
+	{
+		latency_histogram total;
+		merge_into(total);
+		os << _name << ": count=" << total.count();
+		if (total.count())
+		{
+			os << " min=" << total.min()
+				<< " mean=" << total.mean()
+				<< " p50=" << total.value_at_percentile(50)
+				<< " p90=" << total.value_at_percentile(90)
+				<< " p99=" << total.value_at_percentile(99)
+				<< " p99.9=" << total.value_at_percentile(99.9)
+				<< " max=" << total.max();
+		}
+		os << " (ns)\n";
+	}
+
+private:
+	struct node
+	{
+		latency_histogram histogram;
+		node* next;
+	};
+
+	static unsigned next_slot()
+	{
+		static std::atomic<unsigned> slots(0);
+		const unsigned slot = slots.fetch_add(1, std::memory_order_relaxed);
+		if (slot >= BOOST_SAMPLED_TIMING_MAX_RECORDERS)
+			throw std::length_error("boost::sampled_timing: too many latency recorders");
+		return slot;
+	}
+
+	static latency_histogram** thread_slots()
+	{
+		static thread_local latency_histogram* slots[BOOST_SAMPLED_TIMING_MAX_RECORDERS];
+		return slots;
+	}
+
+	latency_histogram& register_thread()
+	{
+		node* n = new node;
+		n->next = _head.load(std::memory_order_relaxed);
+		while (!_head.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed))
+			;
+		return n->histogram;
+	}
+
+	const char* _name;
+	const unsigned _slot;
+	std::atomic<node*> _head;
+};
+
+class scoped_timer
+	: noncopyable
+{
+public:
+	explicit scoped_timer(latency_recorder& recorder)
+		: _recorder(recorder), _start(std::chrono::steady_clock::now())
+	{}
+
+	~scoped_timer()
+	{
+		const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - _start;
+		_recorder.local().record(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+	}
+
+private:
+	latency_recorder& _recorder;
+	const std::chrono::steady_clock::time_point _start;
+};
+
+namespace detail {
+
+inline bool count_down(uint32_t& countdown, uint32_t n)
+{
+	if (countdown)
+	{
+		--countdown;
+		return false;
+	}
+	countdown = n ? n - 1 : 0;
+	return true;
+}
+
+}
+
+// True with probability p on each call (xorshift, per-thread state).
+inline bool with_probability(double p)
+{
+	static thread_local uint64_t state = 0x9e3779b97f4a7c15ull ^ uint64_t(reinterpret_cast<uintptr_t>(&state));
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return double(state >> 11) * (1.0 / 9007199254740992.0) < p;
+}
+
+}
+}
+
+// Each expansion is a distinct lambda type and so has its own countdown.
+#define BOOST_SAMPLED_ONE_IN(n) \
+	::boost::sampled_timing::detail::count_down([]() -> ::boost::uint32_t& { static thread_local ::boost::uint32_t countdown = 0; return countdown; }(), (n))
+
+#define BOOST_SAMPLED_SCOPE_TIMER(condition, recorder) \
+	typedef ::boost::sampled_timing::scoped_timer boost_sampled_scoped_timer; \
+	BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(condition, boost_sampled_scoped_timer, (recorder))
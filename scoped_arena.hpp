@@ -0,0 +1,181 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Scoped monotonic arenas
+=============================
+
+Introduction:
+
+	Request handlers create lots of short-lived temporaries - strings,
+	vectors, maps - and each of them goes through malloc and free. When all
+	of them die at the end of the request anyway, a monotonic arena does the
+	job with a pointer bump per allocation and a single release at the end.
+
+	A scoped_arena installs such an arena as the calling thread's current
+	memory resource for the rest of the scope and throws everything away
+	when the scope is left. Code that allocates through current_resource()
+	picks it up without having to pass an allocator around:
+
+		void handle(const request& r)
+		{
+			typedef boost::arena_allocation::stack_arena<16384> RequestArena;
+			BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(r.use_arena(), RequestArena, ());
+
+			std::pmr::vector<std::pmr::string> parts(boost::arena_allocation::current_resource());
+			...
+		}
+
+	If the predicate is false no arena is installed and current_resource()
+	is whatever it was before - by default std::pmr::get_default_resource().
+
+Synopsis:
+
+	std::pmr::memory_resource* current_resource();
+
+	class scoped_arena
+	{
+		scoped_arena(void* buffer, std::size_t size);
+		std::pmr::memory_resource* resource();
+	};
+
+	template <std::size_t Size>
+	class stack_arena : public scoped_arena
+	{
+		stack_arena();
+	};
+
+	class resource_binding
+	{
+		explicit resource_binding(std::pmr::memory_resource* resource);
+	};
+
+Notes:
+
+	* requires C++17 <memory_resource>.
+
+	* scoped_arena uses a caller supplied buffer (e.g. one taken from a
+	buffer pool); stack_arena carries a Size bytes buffer inline, so with
+	predicated construction it lives in the reserved stack storage.
+
+	* when the buffer runs out, the arena grows by allocating from the
+	resource that was current when it was installed. Those blocks are
+	released together with the rest on scope exit.
+
+	* objects allocated from the arena must not outlive the scope.
+	Deallocation is a no-op; memory is reclaimed only when the arena goes
+	away.
+
+	* arenas nest: an inner arena overflows into the outer one and
+	restores it on exit.
+
+	* resource_binding makes an existing resource (another thread's arena, a
+	pool resource) current for the rest of the scope without owning it, and
+	restores the previous one on exit.
+
+	* the current resource is per thread; an arena is never seen by other
+	threads unless you hand out its resource() explicitly.
+
+*/
+
+#include "predicated_construction.hpp"
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+
+namespace boost {
+namespace arena_allocation {
+
+namespace detail {
+
+inline std::pmr::memory_resource*& thread_resource()
+{
+	static thread_local std::pmr::memory_resource* resource = 0;
+	return resource;
+}
+
+}
+
+// The memory resource scope-local temporaries of the calling thread
+// should allocate from.
+inline std::pmr::memory_resource* current_resource()
+{
+	std::pmr::memory_resource* r = detail::thread_resource();
+	return r ? r : std::pmr::get_default_resource();
+}
+
+class scoped_arena
+	: noncopyable
+{
+public:
+	scoped_arena(void* buffer, std::size_t size)
+		: _previous(detail::thread_resource())
+		, _arena(buffer, size, current_resource())
+	{
+		detail::thread_resource() = &_arena;
+	}
+
+	~scoped_arena()
+	{
+		detail::thread_resource() = _previous;
+	}
+
+	std::pmr::memory_resource* resource()
+	{
+		return &_arena;
+	}
+
+private:
+	std::pmr::memory_resource* const _previous;
+	std::pmr::monotonic_buffer_resource _arena;
+};
+
+namespace detail {
+
+template <std::size_t Size>
+struct arena_buffer
+{
+	alignas(std::max_align_t) unsigned char data[Size];
+};
+
+}
+
+template <std::size_t Size>
+class stack_arena
+	: private detail::arena_buffer<Size>
+	, public scoped_arena
+{
+public:
+	stack_arena()
+		: scoped_arena(this->data, Size)
+	{}
+};
+
+class resource_binding
+	: noncopyable
+{
+public:
+	explicit resource_binding(std::pmr::memory_resource* resource)
+		: _previous(detail::thread_resource())
+	{
+		detail::thread_resource() = resource;
+	}
+
+	~resource_binding()
+	{
+		detail::thread_resource() = _previous;
+	}
+
+private:
+	std::pmr::memory_resource* const _previous;
+};
+
+}
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Per call site registries
+==============================
+
+Introduction:
+
+	The profiling sentries (perf_counters.hpp, allocation_tracking.hpp,
+	predicated_statistics.hpp) all keep their totals in a function-local
+	static per call site and report every site at the end. This header is
+	the part they share: a lock-free list of sites per site type, consistent
+	snapshots of their counters for the reports, and the macro that declares
+	a site and a predicated sentry bound to it.
+
+	A site type derives from registered_site, passing itself, and enlists
+	once its counters are initialized:
+
+		class hit_site
+			: public boost::site_registry::registered_site<hit_site>
+		{
+		public:
+			hit_site(const char* name, const char* file, int line)
+				: registered_site<hit_site>(name, file, line), _hits(0)
+			{
+				enlist();
+			}
+
+			struct snapshot
+			{
+				explicit snapshot(const hit_site& s) : site(&s), hits(s.hits()) {}
+
+				const hit_site* site;
+				uint64_t hits;
+			};
+			...
+		};
+
+		#define HIT_SCOPE(condition, name) \
+			BOOST_REGISTERED_SITE_SCOPE(condition, hit_site, hit_scope, boost_hit_scope, name)
+
+	and its report works on snapshots:
+
+		std::vector<hit_site::snapshot> sites = boost::site_registry::snapshots<hit_site>(&hit_site::snapshot::hits);
+		boost::site_registry::sort_descending(sites, &hit_site::snapshot::hits);
+		for (std::size_t i = 0; i < sites.size(); ++i)
+			boost::site_registry::write_location(os, *sites[i].site) << "hits=" << sites[i].hits << '\n';
+
+Synopsis:
+
+	template <class Site>
+	class registered_site
+	{
+		const char* name() const;
+		const char* file() const;
+		int line() const;
+
+		Site* next() const;
+		static Site* first();
+
+	protected:
+		registered_site(const char* name, const char* file, int line);
+		void enlist();
+	};
+
+	template <class Site, class Snapshot>
+	std::vector<Snapshot> snapshots(uint64_t Snapshot::*used);
+
+	template <class Snapshot>
+	void sort_descending(std::vector<Snapshot>& snapshots, uint64_t Snapshot::*key);
+
+	template <class Site>
+	std::ostream& write_location(std::ostream& os, const registered_site<Site>& site);
+
+	BOOST_REGISTERED_SITE_SCOPE(condition, site, scope, alias, name)
+
+Notes:
+
+	* enlist() publishes the site to concurrent readers, so call it last in
+	the constructor of the derived class, after its counters are set.
+
+	* sites are never removed; they're meant to have static storage duration.
+
+	* the counters keep changing while a report runs. snapshots() reads each
+	site once, so sorting and the derived figures (rates, ratios) all work
+	on the same values.
+
+	* BOOST_REGISTERED_SITE_SCOPE needs predicated_construction.hpp. 'alias'
+	is the name of a local typedef for 'scope', which lets scope types in
+	namespaces go through the predicated macros; it has to be unique per
+	sentry kind, since two kinds on the same line would collide otherwise.
+
+*/
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/preprocessor/cat.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <ostream>
+#include <vector>
+
+namespace boost {
+namespace site_registry {
+
+template <class Site>
+class registered_site
+	: noncopyable
+{
+public:
+	const char* name() const { return _name; }
+	const char* file() const { return _file; }
+	int line() const { return _line; }
+
+	Site* next() const
+	{
+		return _next;
+	}
+
+	static Site* first()
+	{
+		return head().load(std::memory_order_acquire);
+	}
+
+protected:
+	registered_site(const char* name, const char* file, int line)
+		: _name(name), _file(file), _line(line), _next(0)
+	{}
+
+	void enlist()
+	{
+		std::atomic<Site*>& list = head();
+		_next = list.load(std::memory_order_relaxed);
+		while (!list.compare_exchange_weak(_next, static_cast<Site*>(this), std::memory_order_release, std::memory_order_relaxed))
+			;
+	}
+
+private:
+	static std::atomic<Site*>& head()
+	{
+		static std::atomic<Site*> list(0);
+		return list;
+	}
+
+	const char* _name;
+	const char* _file;
+	const int _line;
+	Site* _next;
+};
+
+namespace detail {
+
+template <class Snapshot>
+struct descending
+{
+	explicit descending(uint64_t Snapshot::*key)
+		: key(key)
+	{}
+
+	bool operator()(const Snapshot& a, const Snapshot& b) const
+	{
+		return a.*key > b.*key;
+	}
+
+	uint64_t Snapshot::*key;
+};
+
+}
+
+// A snapshot of every site of type 'Site' whose 'used' counter isn't zero,
+// in registration order.
+template <class Site, class Snapshot>
+std::vector<Snapshot> snapshots(uint64_t Snapshot::*used)
+{
+	std::vector<Snapshot> result;
+	for (const Site* s = Site::first(); s; s = s->next())
+	{
+		const Snapshot snapshot(*s);
+		if (snapshot.*used)
+			result.push_back(snapshot);
+	}
+	return result;
+}
+
+template <class Snapshot>
+void sort_descending(std::vector<Snapshot>& snapshots, uint64_t Snapshot::*key)
+{
+	std::stable_sort(snapshots.begin(), snapshots.end(), detail::descending<Snapshot>(key));
+}
+
+// Writes the "name (file:line): " prefix of a report line.
+template <class Site>
+std::ostream& write_location(std::ostream& os, const registered_site<Site>& site)
+{
+	return os << site.name() << " (" << site.file() << ':' << site.line() << "): ";
+}
+
+}
+}
+
+#define BOOST_REGISTERED_SITE_SCOPE(condition, site, scope, alias, name) \
+	static site BOOST_PP_CAT(alias##_site_,__LINE__)(name, __FILE__, __LINE__); \
+	typedef scope alias; \
+	BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(condition, alias, (BOOST_PP_CAT(alias##_site_,__LINE__)))
@@ -0,0 +1,235 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Coalescing state sentries
+===============================
+
+Introduction:
+
+	The WireframeSentry from predicated_construction.hpp talks to the device
+	twice: once to set the fill mode and once to revert it. Nest a few of
+	those, or create one per draw call, and the device sees long chains of
+	set/revert pairs that cancel out:
+
+		set(FILLMODE, WIREFRAME) draw set(FILLMODE, SOLID)
+		set(FILLMODE, WIREFRAME) draw set(FILLMODE, SOLID)
+		...
+
+	A state_recorder sits between the sentries and the device. Sentries only
+	record the state they want; nothing reaches the device until flush() is
+	called, right before the state is actually needed (i.e. before a draw
+	call). flush() then issues only the net changes:
+
+		set(FILLMODE, WIREFRAME) draw draw ... set(FILLMODE, SOLID)
+
+	The sentries themselves fit predicated construction as usual:
+
+		typedef boost::state_coalescing::state_sentry<render_states> RenderStateSentry;
+
+		BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(renderInWireframe, RenderStateSentry,
+			(recorder, D3DRS_FILLMODE, D3DFILL_WIREFRAME));
+		recorder.flush();
+		device->DrawPrimitive(...);
+
+Synopsis:
+
+	// Describes one kind of device state
+	struct Traits
+	{
+		typedef ... device_type;
+		typedef ... key_type;     // convertible to std::size_t, < key_count
+		typedef ... value_type;   // equality comparable
+		static const std::size_t key_count = ...;
+
+		static value_type get(device_type& device, key_type key);
+		static void set(device_type& device, key_type key, value_type value);
+	};
+
+	template <class Traits>
+	class state_recorder
+	{
+		explicit state_recorder(typename Traits::device_type& device);
+
+		value_type get(key_type key);
+		value_type set(key_type key, value_type value); // returns the previous value
+		void flush();
+		void invalidate();
+	};
+
+	template <class Traits>
+	class state_sentry
+	{
+		state_sentry(state_recorder<Traits>& recorder, key_type key, value_type value);
+	};
+
+Notes:
+
+	* the recorder keeps a flat array of key_count slots plus a command list
+	of dirty keys, both inline; recording never allocates.
+
+	* Traits::get is called at most once per key, the first time the key is
+	touched. After that the recorder is assumed to be the only one changing
+	those states. If something else changes them behind its back (a device
+	reset, third party code), call invalidate(): the next flush() re-applies
+	every tracked state.
+
+	* sentries restore the value that was recorded when they were entered,
+	so they must be destroyed in reverse order of construction - which is
+	what scoping gives you for free.
+
+	* a recorder belongs to one context (device) and is not thread safe,
+	just like the context itself.
+
+*/
+
+#include "predicated_construction.hpp"
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <new>
+
+namespace boost {
+namespace state_coalescing {
+
+template <class Traits>
+class state_recorder
+	: noncopyable
+{
+public:
+	typedef typename Traits::device_type device_type;
+	typedef typename Traits::key_type key_type;
+	typedef typename Traits::value_type value_type;
+
+	explicit state_recorder(device_type& device)
+		: _device(device), _dirty_count(0)
+	{
+		for (std::size_t i = 0; i < Traits::key_count; ++i)
+		{
+			_slots[i].tracked = false;
+			_slots[i].synced = false;
+			_slots[i].dirty = false;
+		}
+	}
+
+	device_type& device() const
+	{
+		return _device;
+	}
+
+	// The value the state will have after the next flush.
+	value_type get(key_type key)
+	{
+		return touch(key).desired;
+	}
+
+	// Records a state change and returns the previously recorded value.
+	value_type set(key_type key, value_type value)
+	{
+		slot& s = touch(key);
+		const value_type previous = s.desired;
+		s.desired = value;
+		mark_dirty(key, s);
+		return previous;
+	}
+
+	// Sends the net state changes since the last flush to the device.
+	void flush()
+	{
+		for (std::size_t i = 0; i < _dirty_count; ++i)
+		{
+			const key_type key = _dirty[i];
+			slot& s = _slots[std::size_t(key)];
+			if (!s.synced || !(s.desired == s.applied))
+			{
+				Traits::set(_device, key, s.desired);
+				s.applied = s.desired;
+				s.synced = true;
+			}
+			s.dirty = false;
+		}
+		_dirty_count = 0;
+	}
+
+	// Forgets what the device state is; the next flush re-applies all
+	// tracked states.
+	void invalidate()
+	{
+		for (std::size_t i = 0; i < Traits::key_count; ++i)
+		{
+			slot& s = _slots[i];
+			if (s.tracked)
+			{
+				s.synced = false;
+				mark_dirty(key_type(i), s);
+			}
+		}
+	}
+
+private:
+	struct slot
+	{
+		value_type desired;
+		value_type applied;
+		bool tracked;
+		bool synced;
+		bool dirty;
+	};
+
+	slot& touch(key_type key)
+	{
+		slot& s = _slots[std::size_t(key)];
+		if (!s.tracked)
+		{
+			s.applied = s.desired = Traits::get(_device, key);
+			s.tracked = true;
+			s.synced = true;
+		}
+		return s;
+	}
+
+	void mark_dirty(key_type key, slot& s)
+	{
+		if (!s.dirty)
+		{
+			s.dirty = true;
+			_dirty[_dirty_count++] = key;
+		}
+	}
+
+	device_type& _device;
+	slot _slots[Traits::key_count];
+	key_type _dirty[Traits::key_count];
+	std::size_t _dirty_count;
+};
+
+template <class Traits>
+class state_sentry
+	: noncopyable
+{
+public:
+	typedef typename Traits::key_type key_type;
+	typedef typename Traits::value_type value_type;
+
+	state_sentry(state_recorder<Traits>& recorder, key_type key, value_type value)
+		: _recorder(recorder), _key(key), _previous(recorder.set(key, value))
+	{}
+
+	~state_sentry()
+	{
+		_recorder.set(_key, _previous);
+	}
+
+private:
+	state_recorder<Traits>& _recorder;
+	const key_type _key;
+	const value_type _previous;
+};
+
+}
+}
@@ -0,0 +1,429 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Conditionally parallel task scopes
+========================================
+
+Introduction:
+
+	Structured concurrency ties the lifetime of spawned work to a scope:
+	a task_group owns everything spawned through it and joins all of it
+	when the scope is left, so no task can outlive the data it refers to.
+
+	Parallelism only pays off above some input size, though. Below it, the
+	pool round trips cost more than the work. Predicated construction lets a
+	single code path cover both cases - the group is only constructed when
+	the input is big enough, and without a group spawned work simply runs
+	inline:
+
+		void transform(std::vector<item>& items)
+		{
+			BOOST_PREDICATED_TASK_SCOPE(items.size() > 10000, scope,
+				boost::structured_concurrency::default_pool());
+
+			for (std::size_t i = 0; i < items.size(); i += 1024)
+				scope.spawn([&items, i] { transform_chunk(items, i, 1024); });
+		} // everything spawned above has finished here
+
+Synopsis:
+
+	class work_stealing_pool
+	{
+		explicit work_stealing_pool(unsigned threads = std::thread::hardware_concurrency());
+		~work_stealing_pool();
+	};
+
+	work_stealing_pool& default_pool();
+
+	class task_group
+	{
+		explicit task_group(work_stealing_pool& pool);
+		~task_group();                      // waits for all tasks
+
+		template <class F> void spawn(F&& f); // F may be move-only
+		void wait();                        // rethrows the first exception
+	};
+
+	class task_scope
+	{
+		explicit task_scope(task_group* group);   // null: run inline
+
+		template <class F> void spawn(F&& f);
+		void wait();
+	};
+
+	BOOST_PREDICATED_TASK_SCOPE(condition, name, pool)
+
+Notes:
+
+	* every worker owns a deque: it pushes and pops its own tasks at the
+	back (most recent, cache-hot work first) and steals from the front of
+	the others' deques when it runs dry. Tasks spawned from threads outside
+	the pool go through a shared injection queue.
+
+	* a thread waiting for a group doesn't block; it runs queued tasks until
+	the group is done, so nested groups can't deadlock the pool.
+
+	* exceptions thrown by tasks are caught; the first one is rethrown by
+	wait(). The destructor waits but doesn't rethrow, so call wait()
+	explicitly if tasks may throw. Inline tasks propagate their exceptions
+	directly.
+
+	* the default pool is a function-local static with one worker per
+	hardware thread.
+
+	* a spawned callable is moved into its task and the task through the
+	queues, never copied, so move-only callables are fine.
+
+*/
+
+#include "predicated_construction.hpp"
+
+#include <boost/noncopyable.hpp>
+#include <boost/preprocessor/cat.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace boost {
+namespace structured_concurrency {
+
+class task_group;
+
+namespace detail {
+
+// A move-only std::function<void ()>: tasks are moved from spawn() into a
+// queue and out of it again, so the callable never has to be copied - and
+// may be move-only.
+class task_function
+{
+public:
+	task_function()
+	{}
+
+	template <class F>
+	task_function(F&& f)
+		: _f(new holder<typename std::decay<F>::type>(std::forward<F>(f)))
+	{}
+
+	void operator () ()
+	{
+		(*_f)();
+	}
+
+private:
+	struct callable
+	{
+		virtual ~callable() {}
+		virtual void operator () () = 0;
+	};
+
+	template <class F>
+	struct holder
+		: callable
+	{
+		template <class G>
+		explicit holder(G&& g)
+			: f(std::forward<G>(g))
+		{}
+
+		void operator () ()
+		{
+			f();
+		}
+
+		F f;
+	};
+
+	std::unique_ptr<callable> _f;
+};
+
+struct task
+{
+	task_function f;
+	task_group* group;
+};
+
+struct task_queue
+{
+	std::mutex mutex;
+	std::deque<task> tasks;
+};
+
+}
+
+class work_stealing_pool
+	: noncopyable
+{
+public:
+	explicit work_stealing_pool(unsigned threads = std::thread::hardware_concurrency())
+		: _queued(0), _sleepers(0), _stop(false)
+	{
+		if (!threads)
+			threads = 1;
+		for (unsigned i = 0; i < threads; ++i)
+			_queues.push_back(new detail::task_queue);
+		for (unsigned i = 0; i < threads; ++i)
+			_threads.push_back(std::thread(&work_stealing_pool::run, this, i));
+	}
+
+	~work_stealing_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_sleep_mutex);
+			_stop = true;
+		}
+		_wake.notify_all();
+		for (std::size_t i = 0; i < _threads.size(); ++i)
+			_threads[i].join();
+		for (std::size_t i = 0; i < _queues.size(); ++i)
+			delete _queues[i];
+	}
+
+	void submit(detail::task&& t)
+	{
+		detail::task_queue& q = current_worker() >= 0 ? *_queues[current_worker()] : _injection;
+		{
+			std::lock_guard<std::mutex> lock(q.mutex);
+			q.tasks.push_back(std::move(t));
+		}
+		_queued.fetch_add(1, std::memory_order_seq_cst);
+		if (_sleepers.load(std::memory_order_seq_cst))
+		{
+			std::lock_guard<std::mutex> lock(_sleep_mutex);
+			_wake.notify_one();
+		}
+	}
+
+	// Runs one queued task, if there is any; returns whether it did.
+	bool try_run_one()
+	{
+		detail::task t;
+		if (!take(current_worker(), t))
+			return false;
+		execute(t);
+		return true;
+	}
+
+private:
+	// Index of the calling thread among this pool's workers, -1 if it's not one.
+	int current_worker() const
+	{
+		return worker_pool() == this ? worker_index() : -1;
+	}
+
+	static const work_stealing_pool*& worker_pool()
+	{
+		static thread_local const work_stealing_pool* pool = 0;
+		return pool;
+	}
+
+	static int& worker_index()
+	{
+		static thread_local int index = -1;
+		return index;
+	}
+
+	static bool pop_back(detail::task_queue& q, detail::task& t)
+	{
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if (q.tasks.empty())
+			return false;
+		t = std::move(q.tasks.back());
+		q.tasks.pop_back();
+		return true;
+	}
+
+	static bool pop_front(detail::task_queue& q, detail::task& t)
+	{
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if (q.tasks.empty())
+			return false;
+		t = std::move(q.tasks.front());
+		q.tasks.pop_front();
+		return true;
+	}
+
+	bool take(int self, detail::task& t)
+	{
+		if (!_queued.load(std::memory_order_relaxed))
+			return false;
+		bool found = (self >= 0 && pop_back(*_queues[self], t)) || pop_front(_injection, t);
+		const std::size_t n = _queues.size();
+		for (std::size_t i = 1; !found && i <= n; ++i)
+		{
+			const std::size_t victim = (std::size_t(self < 0 ? 0 : self) + i) % n;
+			found = pop_front(*_queues[victim], t);
+		}
+		if (found)
+			_queued.fetch_sub(1, std::memory_order_relaxed);
+		return found;
+	}
+
+	void execute(detail::task& t);
+
+	void run(int index)
+	{
+		worker_pool() = this;
+		worker_index() = index;
+		for (;;)
+		{
+			if (try_run_one())
+				continue;
+			std::unique_lock<std::mutex> lock(_sleep_mutex);
+			_sleepers.fetch_add(1, std::memory_order_seq_cst);
+			while (!_stop && !_queued.load(std::memory_order_seq_cst))
+				_wake.wait(lock);
+			_sleepers.fetch_sub(1, std::memory_order_relaxed);
+			if (_stop && !_queued.load(std::memory_order_relaxed))
+				return;
+		}
+	}
+
+	std::vector<detail::task_queue*> _queues;
+	detail::task_queue _injection;
+	std::vector<std::thread> _threads;
+
+	std::atomic<std::size_t> _queued;
+	std::atomic<unsigned> _sleepers;
+	bool _stop;
+	std::mutex _sleep_mutex;
+	std::condition_variable _wake;
+};
+
+class task_group
+	: noncopyable
+{
+public:
+	explicit task_group(work_stealing_pool& pool)
+		: _pool(pool), _pending(0)
+	{}
+
+	~task_group()
+	{
+		join();
+	}
+
+	template <class F>
+	void spawn(F&& f)
+	{
+		_pending.fetch_add(1, std::memory_order_relaxed);
+		detail::task t = { std::forward<F>(f), this };
+		_pool.submit(std::move(t));
+	}
+
+	void wait()
+	{
+		join();
+		std::exception_ptr e;
+		{
+			std::lock_guard<std::mutex> lock(_error_mutex);
+			e = _error;
+			_error = std::exception_ptr();
+		}
+		if (e)
+			std::rethrow_exception(e);
+	}
+
+private:
+	friend class work_stealing_pool;
+
+	void join()
+	{
+		while (_pending.load(std::memory_order_acquire))
+		{
+			if (!_pool.try_run_one())
+				std::this_thread::yield();
+		}
+	}
+
+	void run(detail::task& t)
+	{
+		try
+		{
+			t.f();
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(_error_mutex);
+			if (!_error)
+				_error = std::current_exception();
+		}
+		_pending.fetch_sub(1, std::memory_order_release);
+	}
+
+	work_stealing_pool& _pool;
+	std::atomic<std::size_t> _pending;
+	std::mutex _error_mutex;
+	std::exception_ptr _error;
+};
+
+inline void work_stealing_pool::execute(detail::task& t)
+{
+	t.group->run(t);
+}
+
+inline work_stealing_pool& default_pool()
+{
+	static work_stealing_pool pool;
+	return pool;
+}
+
+class task_scope
+	: noncopyable
+{
+public:
+	explicit task_scope(task_group* group)
+		: _group(group)
+	{}
+
+	template <class F>
+	void spawn(F&& f)
+	{
+		if (_group)
+			_group->spawn(std::forward<F>(f));
+		else
+			f();
+	}
+
+	void wait()
+	{
+		if (_group)
+			_group->wait();
+	}
+
+	bool parallel() const
+	{
+		return _group != 0;
+	}
+
+private:
+	task_group* _group;
+};
+
+}
+}
+
+#define BOOST_PREDICATED_TASK_SCOPE(condition, name, pool) \
+	BOOST_PREDICATED_TASK_SCOPE_I(condition, name, pool, BOOST_PP_CAT(name##_group_type_,__LINE__))
+
+// The predicated constructor pastes its type into the names of its storage,
+// so the group type goes in through a hidden, line-unique typedef.
+#define BOOST_PREDICATED_TASK_SCOPE_I(condition, name, pool, group_type) \
+	typedef ::boost::structured_concurrency::task_group group_type; \
+	BOOST_PREDICATED_POINTER_CONSTRUCTOR(condition, BOOST_PP_CAT(name##_group_,__LINE__), group_type, (pool)); \
+	::boost::structured_concurrency::task_scope name(BOOST_PP_CAT(name##_group_,__LINE__))
@@ -0,0 +1,174 @@
+#  Distributed under the Boost
+#  Software License, Version 1.0. (See accompanying file
+#  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+# Code generation regression check for custom operators and predicated
+# construction, automating the disassembly comparison described in
+# custom_ops.hpp ("Debug builds") and predicated_construction.hpp ("Code
+# generation"):
+#
+#	python3 tests/codegen/check_codegen.py [--cxx g++] [--flags "-I/path/to/boost"]
+#
+# Compiles custom_op.cpp and predicated_sentry.cpp, disassembles them with
+# objdump -dr and fails if
+#
+#	* with -O2 (with and without BOOST_CUSTOM_OPS_FORCE_INLINE), custom_op
+#	doesn't compile to the instructions of custom_op_by_hand, or the hot path
+#	of predicated_sentry calls anything but enable, work and disable, or
+#	accesses the stack frame more than predicated_sentry_by_hand;
+#
+#	* with -O0 and BOOST_CUSTOM_OPS_FORCE_INLINE, custom_op makes any call
+#	other than the one to the operator's body.
+#
+# Only x86-64 code is checked; elsewhere, or without objdump, the check is
+# skipped with exit code 77.
+
+import argparse
+import os
+import platform
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.abspath(os.path.dirname(__file__))
+ROOT = os.path.dirname(os.path.dirname(HERE))
+
+SKIP = 77
+
+SYMBOL = re.compile(r'^[0-9a-f]+ <(?P<name>[^>]+)>:$')
+INSTRUCTION = re.compile(r'^\s+[0-9a-f]+:\t(?P<text>.*)$')
+RELOCATION = re.compile(r'^\s+[0-9a-f]+: R_\S+\s+(?P<target>[^+-]+)')
+PADDING = re.compile(r'^(nop|xchg\s+%ax,%ax|data16|cs nop|int3)')
+STACK = re.compile(r'\(%[re]?(sp|bp)[,)]')
+
+failures = []
+
+
+class function:
+	def __init__(self, name):
+		self.name = name
+		self.instructions = []   # [text, call target or None]
+
+	def body(self):
+		return [text for text, _ in self.instructions if not PADDING.match(text)]
+
+	def calls(self):
+		return [target for text, target in self.instructions if target is not None]
+
+	def stack_accesses(self):
+		return [text for text in self.body() if STACK.search(text) and not re.match(r'(push|pop)\b', text)]
+
+
+def disassemble(path):
+	output = subprocess.run(['objdump', '-dr', '--no-show-raw-insn', path], check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+	functions = {}
+	current = None
+	for line in output.splitlines():
+		m = SYMBOL.match(line)
+		if m:
+			current = functions.setdefault(m.group('name'), function(m.group('name')))
+			continue
+		if current is None:
+			continue
+		m = RELOCATION.match(line)
+		if m and current.instructions:
+			text, target = current.instructions[-1]
+			# A tail call is a jmp to a symbol; jumps to sections (the cold
+			# part of the function) are not calls.
+			if re.match(r'(call|jmp)\b', text) and not m.group('target').startswith('.'):
+				current.instructions[-1][1] = m.group('target')
+			continue
+		m = INSTRUCTION.match(line)
+		if m:
+			text = ' '.join(m.group('text').split())
+			target = None
+			if text.startswith('call'):
+				# Calls resolved within the object carry the callee in <...>.
+				callee = re.search(r'<([^>+]+)', text)
+				target = callee.group(1) if callee else text
+			current.instructions.append([text, target])
+	return functions
+
+
+def compile_and_disassemble(cxx, flags, source, work):
+	obj = os.path.join(work, os.path.basename(source) + '.o')
+	subprocess.run([cxx] + flags + ['-I' + ROOT, '-c', source, '-o', obj], check=True)
+	return disassemble(obj)
+
+
+def expect(condition, message):
+	print(('ok      ' if condition else 'FAILED  ') + message)
+	if not condition:
+		failures.append(message)
+
+
+def strip_addresses(text):
+	# Branch targets are absolute offsets within the section.
+	return re.sub(r'\b[0-9a-f]+ <[^>]*>', '<target>', text)
+
+
+def check_optimized(cxx, flags, work, label):
+	ops = compile_and_disassemble(cxx, flags, os.path.join(HERE, 'custom_op.cpp'), work)
+	op, by_hand = ops['custom_op'], ops['custom_op_by_hand']
+	expect(not op.calls(), '%s: custom_op makes no calls (%s)' % (label, ', '.join(op.calls()) or 'none'))
+	expect([strip_addresses(t) for t in op.body()] == [strip_addresses(t) for t in by_hand.body()],
+		'%s: custom_op compiles to the instructions of custom_op_by_hand' % label)
+
+	sentries = compile_and_disassemble(cxx, flags, os.path.join(HERE, 'predicated_sentry.cpp'), work)
+	# The exception landing pad goes to a [clone .cold] symbol of its own,
+	# so the function's symbol covers the hot path only.
+	sentry, by_hand = sentries['predicated_sentry'], sentries['predicated_sentry_by_hand']
+	extra = sorted(set(sentry.calls()) - set(['enable', 'work', 'disable']))
+	expect(not extra, '%s: predicated_sentry calls only enable, work and disable (%s)' % (label, ', '.join(extra) or 'no others'))
+	expect(set(sentry.calls()) == set(by_hand.calls()), '%s: predicated_sentry calls what predicated_sentry_by_hand calls' % label)
+	expect(len(sentry.stack_accesses()) <= len(by_hand.stack_accesses()),
+		'%s: predicated_sentry accesses the stack frame no more than by hand (%s)' % (label, '; '.join(sentry.stack_accesses()) or 'none'))
+
+
+def check_unoptimized(cxx, flags, work):
+	ops = compile_and_disassemble(cxx, flags + ['-O0', '-DBOOST_CUSTOM_OPS_FORCE_INLINE'], os.path.join(HERE, 'custom_op.cpp'), work)
+	calls = ops['custom_op'].calls()
+	expect(len(calls) == 1 and 'boost_custom_ops_implementation_' in calls[0],
+		'-O0 BOOST_CUSTOM_OPS_FORCE_INLINE: custom_op only calls the body (%s)' % ', '.join(calls))
+	plain = compile_and_disassemble(cxx, flags + ['-O0'], os.path.join(HERE, 'custom_op.cpp'), work)
+	print('info    -O0: custom_op makes %d calls without BOOST_CUSTOM_OPS_FORCE_INLINE' % len(plain['custom_op'].calls()))
+
+
+def main():
+	parser = argparse.ArgumentParser(description='Code generation regression check.')
+	parser.add_argument('--cxx', default=os.environ.get('CXX', 'g++'))
+	parser.add_argument('--flags', default='', help='extra compiler flags, one string')
+	args = parser.parse_args()
+
+	if platform.machine().lower() not in ('x86_64', 'amd64'):
+		print('skipped: not an x86-64 host')
+		return SKIP
+	if not shutil.which('objdump'):
+		print('skipped: objdump not found')
+		return SKIP
+	target = subprocess.run([args.cxx, '-dumpmachine'], stdout=subprocess.PIPE, universal_newlines=True).stdout
+	if not target.startswith('x86_64'):
+		print('skipped: %s does not target x86-64' % args.cxx)
+		return SKIP
+
+	flags = ['-std=c++11']
+	version = subprocess.run([args.cxx, '--version'], stdout=subprocess.PIPE, universal_newlines=True).stdout
+	if 'clang' not in version:
+		# Identical code folding would turn custom_op into a jump to
+		# custom_op_by_hand.
+		flags.append('-fno-ipa-icf')
+	flags += args.flags.split()
+	work = tempfile.mkdtemp()
+	try:
+		check_optimized(args.cxx, flags + ['-O2'], work, '-O2')
+		check_optimized(args.cxx, flags + ['-O2', '-DBOOST_CUSTOM_OPS_FORCE_INLINE'], work, '-O2 BOOST_CUSTOM_OPS_FORCE_INLINE')
+		check_unoptimized(args.cxx, flags, work)
+	finally:
+		shutil.rmtree(work)
+	return 1 if failures else 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
@@ -0,0 +1,35 @@
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// A custom operator application next to its body written out by hand.
+// check_codegen.py expects the two to compile to the same instructions with
+// optimization, and custom_op to make a single call - to the body - at -O0
+// with BOOST_CUSTOM_OPS_FORCE_INLINE.
+
+#include "custom_ops.hpp"
+
+struct A
+{
+	int a;
+};
+
+struct B
+{
+	int b;
+};
+
+BOOST_CUSTOM_OP(int, const A&, a, /, ~+!, -, const B&, b)
+{
+	return a.a * 2 + b.b * 3;
+}
+
+extern "C" int custom_op(const A& a, const B& b)
+{
+	return a /~+!- b;
+}
+
+extern "C" int custom_op_by_hand(const A& a, const B& b)
+{
+	return a.a * 2 + b.b * 3;
+}
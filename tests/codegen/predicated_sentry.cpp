@@ -0,0 +1,46 @@
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// A predicated sentry next to the if / work / if it stands for. With
+// optimization check_codegen.py expects the hot path of predicated_sentry
+// to call nothing but enable, work and disable and to keep the storage
+// pointer out of the stack frame, like predicated_sentry_by_hand.
+
+#include "predicated_construction.hpp"
+
+extern "C" void enable(int* device);
+extern "C" void disable(int* device);
+extern "C" void work();
+
+struct sentry
+{
+	explicit sentry(int* device)
+		: _device(device)
+	{
+		enable(_device);
+	}
+
+	~sentry()
+	{
+		disable(_device);
+	}
+
+private:
+	int* _device;
+};
+
+extern "C" void predicated_sentry(bool condition, int* device)
+{
+	BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(condition, sentry, (device));
+	work();
+}
+
+extern "C" void predicated_sentry_by_hand(bool condition, int* device)
+{
+	if (condition)
+		enable(device);
+	work();
+	if (condition)
+		disable(device);
+}
@@ -0,0 +1,71 @@
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// BOOST_CUSTOM_LAZY_OP: the right operand is evaluated only on demand, and a
+// reference-typed operand is handed to the body by value rather than as a
+// reference to the thunk's temporary.
+
+#include "custom_ops.hpp"
+
+#include <boost/core/lightweight_test.hpp>
+
+namespace {
+
+struct filter
+{
+	bool selective;
+};
+
+struct big
+{
+	int values[256];
+};
+
+int evaluations;
+
+bool expensive(bool result)
+{
+	++evaluations;
+	return result;
+}
+
+big make_big(int first)
+{
+	big b;
+	for (int i = 0; i < 256; ++i)
+		b.values[i] = first + i;
+	return b;
+}
+
+BOOST_CUSTOM_LAZY_OP(bool, const filter&, a, &&, , ~, bool, b)
+{
+	return a.selective && b();
+}
+
+BOOST_CUSTOM_LAZY_OP(int, const filter&, a, /, , ~, const big&, b)
+{
+	if (!a.selective)
+		return -1;
+	const big copy = b();
+	return copy.values[0] + copy.values[255];
+}
+
+}
+
+int main()
+{
+	const filter off = { false };
+	const filter on = { true };
+
+	BOOST_TEST(!(off &&~ BOOST_CUSTOM_OP_DEFER(expensive(true))));
+	BOOST_TEST_EQ(evaluations, 0);
+	BOOST_TEST(on &&~ BOOST_CUSTOM_OP_DEFER(expensive(true)));
+	BOOST_TEST(!(on &&~ BOOST_CUSTOM_OP_DEFER(expensive(false))));
+	BOOST_TEST_EQ(evaluations, 2);
+
+	BOOST_TEST_EQ(off /~ BOOST_CUSTOM_OP_DEFER(make_big(10)), -1);
+	BOOST_TEST_EQ(on /~ BOOST_CUSTOM_OP_DEFER(make_big(10)), 10 + 265);
+
+	return boost::report_errors();
+}
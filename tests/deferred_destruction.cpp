@@ -0,0 +1,118 @@
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Deferred destruction: after several threads have left deferred scopes
+// concurrently and the reclaimer has been flushed, every constructed object
+// has been destroyed exactly once, on the reclaimer's thread and in FIFO
+// order per producer. Opted-out types are destroyed in place.
+
+#include "deferred_destruction.hpp"
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int producers = 4;
+const int scopes = 20000;
+
+std::atomic<int> constructed(0);
+std::atomic<int> destroyed(0);
+std::atomic<int> inline_destructions(0);
+std::thread::id producer_ids[producers];
+
+// Written by the reclaimer thread only; read after flush().
+int last_destroyed[producers];
+int out_of_order;
+
+struct payload
+{
+	payload(int producer, int sequence)
+		: _producer(producer), _sequence(sequence)
+	{
+		constructed.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	~payload()
+	{
+		if (std::this_thread::get_id() == producer_ids[_producer])
+			inline_destructions.fetch_add(1, std::memory_order_relaxed);
+		if (_sequence <= last_destroyed[_producer])
+			++out_of_order;
+		last_destroyed[_producer] = _sequence;
+		destroyed.fetch_add(1, std::memory_order_relaxed);
+	}
+
+private:
+	int _producer;
+	int _sequence;
+};
+
+struct journal
+{
+	explicit journal(int& open)
+		: _open(open)
+	{
+		++_open;
+	}
+
+	~journal()
+	{
+		--_open;
+	}
+
+private:
+	int& _open;
+};
+
+}
+
+namespace boost { namespace deferred_destruction {
+	template <> struct defer<journal> : boost::false_type {};
+}}
+
+namespace {
+
+void produce(int producer)
+{
+	producer_ids[producer] = std::this_thread::get_id();
+	for (int i = 0; i < scopes; ++i)
+	{
+		BOOST_PREDICATED_DEFERRED_ANONYMOUS_CONSTRUCTOR(i % 3 != 0, payload, (producer, i));
+	}
+}
+
+}
+
+int main()
+{
+	for (int p = 0; p < producers; ++p)
+		last_destroyed[p] = -1;
+
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; ++p)
+		threads.push_back(std::thread(&produce, p));
+	for (std::size_t t = 0; t < threads.size(); ++t)
+		threads[t].join();
+
+	boost::deferred_destruction::default_reclaimer().flush();
+
+	const int expected = producers * (scopes - (scopes + 2) / 3);
+	BOOST_TEST_EQ(constructed.load(), expected);
+	BOOST_TEST_EQ(destroyed.load(), expected);
+	BOOST_TEST_EQ(inline_destructions.load(), 0);
+	BOOST_TEST_EQ(out_of_order, 0);
+
+	int open = 0;
+	{
+		BOOST_PREDICATED_DEFERRED_ANONYMOUS_CONSTRUCTOR(true, journal, (open));
+		BOOST_TEST_EQ(open, 1);
+	}
+	BOOST_TEST_EQ(open, 0);
+
+	return boost::report_errors();
+}
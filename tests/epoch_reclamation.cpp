@@ -0,0 +1,125 @@
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Epoch-based reclamation: a retired object is not freed while any thread
+// that might still see it is inside a read guard, however often the writer
+// collects, and is freed once every thread has left its epoch. Readers
+// racing with a writer that swaps and retires never see a freed node.
+
+#include "epoch_reclamation.hpp"
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int live = 0x5eed;
+
+std::atomic<int> freed(0);
+
+struct node
+{
+	explicit node(int v)
+		: value(v)
+	{}
+
+	~node()
+	{
+		value = 0;
+		freed.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	int value;
+};
+
+void wait_for(const std::atomic<int>& phase, int value)
+{
+	while (phase.load(std::memory_order_acquire) != value)
+		std::this_thread::yield();
+}
+
+void grace_period()
+{
+	static boost::epoch_reclamation::epoch_domain domain;
+	const int retired = 3 * BOOST_EPOCH_COLLECT_THRESHOLD;
+	std::atomic<int> phase(0);
+
+	std::thread reader([&phase]
+	{
+		{
+			BOOST_EPOCH_READ_GUARD(true, domain);
+			phase.store(1, std::memory_order_release);
+			wait_for(phase, 2);
+		}
+		phase.store(3, std::memory_order_release);
+	});
+
+	wait_for(phase, 1);
+	freed.store(0);
+	for (int i = 0; i < retired; ++i)
+		domain.retire(new node(live));
+	for (int i = 0; i < 10; ++i)
+		domain.collect();
+	BOOST_TEST_EQ(freed.load(), 0);
+
+	phase.store(2, std::memory_order_release);
+	wait_for(phase, 3);
+	for (int i = 0; i < 3; ++i)
+		domain.collect();
+	BOOST_TEST_EQ(freed.load(), retired);
+
+	reader.join();
+}
+
+void concurrent_readers()
+{
+	static boost::epoch_reclamation::epoch_domain domain;
+	const int readers = 3;
+	const int swaps = 20000;
+	std::atomic<node*> current(new node(live));
+	std::atomic<bool> done(false);
+	std::atomic<int> stale(0);
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < readers; ++t)
+		threads.push_back(std::thread([&]
+		{
+			while (!done.load(std::memory_order_acquire))
+			{
+				BOOST_EPOCH_READ_GUARD(true, domain);
+				if (current.load(std::memory_order_acquire)->value != live)
+					stale.fetch_add(1, std::memory_order_relaxed);
+			}
+		}));
+
+	freed.store(0);
+	for (int i = 0; i < swaps; ++i)
+		domain.retire(current.exchange(new node(live), std::memory_order_acq_rel));
+
+	done.store(true, std::memory_order_release);
+	for (std::size_t t = 0; t < threads.size(); ++t)
+		threads[t].join();
+
+	BOOST_TEST_EQ(stale.load(), 0);
+	BOOST_TEST(freed.load() > 0);
+	BOOST_TEST(freed.load() <= swaps);
+
+	for (int i = 0; i < 3; ++i)
+		domain.collect();
+	BOOST_TEST_EQ(freed.load(), swaps);
+	delete current.load();
+}
+
+}
+
+int main()
+{
+	grace_period();
+	concurrent_readers();
+
+	return boost::report_errors();
+}
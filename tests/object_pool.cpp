@@ -0,0 +1,98 @@
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Borrowing from an object_pool: under contention no instance is ever lent
+// to two scopes at once, a reserved pool with more slots than borrowers
+// never has to call its factory, every instance is returned, and the pool
+// deletes exactly what it made.
+
+#include "object_pool.hpp"
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int borrowers = 4;
+const int capacity = 2 * borrowers;
+const int borrows = 50000;
+
+std::atomic<int> made(0);
+std::atomic<int> deleted(0);
+std::atomic<int> shared(0);
+
+struct instance
+{
+	instance()
+		: borrowed(false), uses(0)
+	{
+		made.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	~instance()
+	{
+		deleted.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	std::atomic<bool> borrowed;
+	int uses;
+};
+
+void borrow(boost::pooled_construction::object_pool<instance>& pool)
+{
+	for (int i = 0; i < borrows; ++i)
+	{
+		BOOST_PREDICATED_BORROW(i % 4 != 0, x, instance, pool);
+		if (i % 4 == 0)
+			continue;
+		if (x.borrowed.exchange(true, std::memory_order_relaxed))
+			shared.fetch_add(1, std::memory_order_relaxed);
+		++x.uses;
+		x.borrowed.store(false, std::memory_order_relaxed);
+	}
+}
+
+}
+
+int main()
+{
+	{
+		boost::pooled_construction::object_pool<instance> pool(capacity);
+		pool.reserve(capacity);
+		BOOST_TEST_EQ(made.load(), capacity);
+
+		std::vector<std::thread> threads;
+		for (int t = 0; t < borrowers; ++t)
+			threads.push_back(std::thread(&borrow, std::ref(pool)));
+		for (std::size_t t = 0; t < threads.size(); ++t)
+			threads[t].join();
+
+		BOOST_TEST_EQ(shared.load(), 0);
+		BOOST_TEST_EQ(made.load(), capacity);
+		BOOST_TEST_EQ(deleted.load(), 0);
+
+		// every instance is back: draining the pool yields each one once,
+		// and the uses add up to the borrows that happened
+		std::vector<instance*> idle;
+		int uses = 0;
+		for (int i = 0; i < capacity; ++i)
+		{
+			idle.push_back(pool.acquire());
+			for (int j = 0; j < i; ++j)
+				BOOST_TEST(idle[j] != idle[i]);
+			uses += idle[i]->uses;
+		}
+		BOOST_TEST_EQ(made.load(), capacity);
+		BOOST_TEST_EQ(uses, borrowers * (borrows - borrows / 4));
+		for (int i = 0; i < capacity; ++i)
+			pool.release(idle[i]);
+	}
+	BOOST_TEST_EQ(deleted.load(), capacity);
+
+	return boost::report_errors();
+}
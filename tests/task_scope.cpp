@@ -0,0 +1,94 @@
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// BOOST_PREDICATED_TASK_SCOPE: every spawned task has run when the scope is
+// left, in parallel or inline; wait() rethrows an exception thrown by a
+// task; move-only callables can be spawned.
+
+#include "task_scope.hpp"
+
+#include <boost/core/lightweight_test.hpp>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+const int tasks = 1000;
+
+long sum(bool parallel, boost::structured_concurrency::work_stealing_pool& pool)
+{
+	std::atomic<long> total(0);
+	{
+		BOOST_PREDICATED_TASK_SCOPE(parallel, scope, pool);
+		BOOST_TEST_EQ(scope.parallel(), parallel);
+		for (int i = 1; i <= tasks; ++i)
+			scope.spawn([&total, i] { total.fetch_add(i, std::memory_order_relaxed); });
+	}
+	return total.load();
+}
+
+bool rethrows(bool parallel, boost::structured_concurrency::work_stealing_pool& pool)
+{
+	std::atomic<int> completed(0);
+	try
+	{
+		BOOST_PREDICATED_TASK_SCOPE(parallel, scope, pool);
+		for (int i = 0; i < tasks; ++i)
+			scope.spawn([&completed, i]
+			{
+				if (i == tasks / 2)
+					throw std::runtime_error("task");
+				completed.fetch_add(1, std::memory_order_relaxed);
+			});
+		scope.wait();
+	}
+	catch (const std::runtime_error&)
+	{
+		// in parallel every other task still ran; inline the loop stopped
+		BOOST_TEST_EQ(completed.load(), parallel ? tasks - 1 : tasks / 2);
+		return true;
+	}
+	return false;
+}
+
+struct move_only_task
+{
+	explicit move_only_task(std::atomic<int>& runs)
+		: _runs(new int(1)), _counter(&runs)
+	{}
+
+	void operator () ()
+	{
+		_counter->fetch_add(*_runs, std::memory_order_relaxed);
+	}
+
+	std::unique_ptr<int> _runs;
+	std::atomic<int>* _counter;
+};
+
+}
+
+int main()
+{
+	boost::structured_concurrency::work_stealing_pool pool(4);
+	const long expected = long(tasks) * (tasks + 1) / 2;
+
+	BOOST_TEST_EQ(sum(true, pool), expected);
+	BOOST_TEST_EQ(sum(false, pool), expected);
+
+	BOOST_TEST(rethrows(true, pool));
+	BOOST_TEST(rethrows(false, pool));
+
+	std::atomic<int> runs(0);
+	{
+		BOOST_PREDICATED_TASK_SCOPE(true, scope, pool);
+		for (int i = 0; i < tasks; ++i)
+			scope.spawn(move_only_task(runs));
+	}
+	BOOST_TEST_EQ(runs.load(), tasks);
+
+	return boost::report_errors();
+}
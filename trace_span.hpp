@@ -0,0 +1,292 @@
+#pragma once
+
+//  Distributed under the Boost
+//  Software License, Version 1.0. (See accompanying file
+//  LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+/*
+
+	Predicated trace spans
+============================
+
+Introduction:
+
+	A trace span marks the beginning and the end of a scope in a timeline.
+	Spans are cheap only if the disabled case is cheap, and predicated
+	construction makes it exactly one 'if':
+
+		static const boost::tracing::category render = { 1u << 0, "render" };
+
+		void draw_scene(...)
+		{
+			BOOST_TRACE_SPAN(2, render, "draw_scene");
+			...
+		}
+
+	The span is constructed only if the runtime trace level is at least 2
+	and the 'render' bit is set in the runtime category mask. Otherwise
+	nothing happens (save for two relaxed loads and an 'if').
+
+	A constructed span writes a begin event into the calling thread's ring
+	buffer and an end event on scope exit. Ring buffers have a fixed size,
+	are allocated once per thread and are written without locks; when full,
+	the oldest events are overwritten. At any time the contents of all
+	buffers can be written out as Chrome trace-event JSON and opened in
+	chrome://tracing or Perfetto.
+
+Synopsis:
+
+	struct category
+	{
+		uint32_t mask;
+		const char* name;
+	};
+
+	void set_level(int level);
+	void set_categories(uint32_t mask);
+	bool enabled(int level, uint32_t mask);
+
+	class trace_span
+	{
+		trace_span(const char* category, const char* name);
+	};
+
+	void export_chrome_json(std::ostream& os);
+
+	BOOST_TRACE_SPAN(level, category, name)
+
+Notes:
+
+	* tracing is off by default (level 0, empty category mask).
+
+	* category and span names are stored by pointer and must outlive the
+	trace; string literals are the intended use.
+
+	* the ring capacity is BOOST_TRACE_RING_CAPACITY events per thread and
+	must be a power of two.
+
+	* exporting while threads are tracing is safe: events overwritten during
+	the export are dropped instead of being written out torn. Spans whose
+	begin event was overwritten show up as unmatched end events, which
+	trace viewers ignore.
+
+	* ring buffers are never freed, so events of threads that have already
+	exited are still exported.
+
+*/
+
+#include "predicated_construction.hpp"
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/static_assert.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <ostream>
+
+#ifndef BOOST_TRACE_RING_CAPACITY
+#define BOOST_TRACE_RING_CAPACITY 4096
+#endif
+
+namespace boost {
+namespace tracing {
+
+struct category
+{
+	uint32_t mask;
+	const char* name;
+};
+
+namespace detail {
+
+BOOST_STATIC_ASSERT((BOOST_TRACE_RING_CAPACITY & (BOOST_TRACE_RING_CAPACITY - 1)) == 0);
+
+inline std::atomic<int>& level_flag()
+{
+	static std::atomic<int> level(0);
+	return level;
+}
+
+inline std::atomic<uint32_t>& category_flags()
+{
+	static std::atomic<uint32_t> mask(0);
+	return mask;
+}
+
+// 'sequence' is 2 * index + 1 while event 'index' is being written into the
+// slot and 2 * index + 2 once it's complete, which lets readers tell an
+// intact event from one that is being overwritten.
+struct event
+{
+	std::atomic<uint64_t> sequence;
+	std::atomic<const char*> name;
+	std::atomic<const char*> category;
+	std::atomic<uint64_t> timestamp;
+	std::atomic<char> phase;
+};
+
+struct ring
+	: noncopyable
+{
+	static const uint64_t capacity = BOOST_TRACE_RING_CAPACITY;
+
+	explicit ring(unsigned tid)
+		: head(0), thread_id(tid), next(0)
+	{
+		for (uint64_t i = 0; i < capacity; ++i)
+			events[i].sequence.store(0, std::memory_order_relaxed);
+	}
+
+	// Single writer: the owning thread.
+	void push(char phase, const char* cat, const char* name)
+	{
+		const uint64_t h = head.load(std::memory_order_relaxed);
+		event& e = events[h & (capacity - 1)];
+		e.sequence.store(2 * h + 1, std::memory_order_relaxed);
+		// Orders the mark above before the field stores: a reader that sees
+		// any of the new fields also sees the slot marked as being written.
+		std::atomic_thread_fence(std::memory_order_release);
+		e.name.store(name, std::memory_order_relaxed);
+		e.category.store(cat, std::memory_order_relaxed);
+		e.timestamp.store(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count()), std::memory_order_relaxed);
+		e.phase.store(phase, std::memory_order_relaxed);
+		e.sequence.store(2 * h + 2, std::memory_order_release);
+		head.store(h + 1, std::memory_order_release);
+	}
+
+	event events[BOOST_TRACE_RING_CAPACITY];
+	std::atomic<uint64_t> head;
+	const unsigned thread_id;
+	ring* next;
+};
+
+inline std::atomic<ring*>& ring_list()
+{
+	static std::atomic<ring*> head(0);
+	return head;
+}
+
+inline ring& new_thread_ring()
+{
+	static std::atomic<unsigned> thread_ids(0);
+	ring* r = new ring(thread_ids.fetch_add(1, std::memory_order_relaxed) + 1);
+	std::atomic<ring*>& list = ring_list();
+	r->next = list.load(std::memory_order_relaxed);
+	while (!list.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed))
+		;
+	return *r;
+}
+
+inline ring& thread_ring()
+{
+	static thread_local ring* r = 0;
+	if (!r)
+		r = &new_thread_ring();
+	return *r;
+}
+
+inline void write_json_string(std::ostream& os, const char* s)
+{
+	static const char hex[] = "0123456789abcdef";
+	os << '"';
+	for (; *s; ++s)
+	{
+		const unsigned char c = static_cast<unsigned char>(*s);
+		if (c == '"' || c == '\\')
+			os << '\\' << char(c);
+		else if (c < 0x20)
+			os << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+		else
+			os << char(c);
+	}
+	os << '"';
+}
+
+}
+
+inline void set_level(int level)
+{
+	detail::level_flag().store(level, std::memory_order_relaxed);
+}
+
+inline void set_categories(uint32_t mask)
+{
+	detail::category_flags().store(mask, std::memory_order_relaxed);
+}
+
+inline bool enabled(int level, uint32_t mask)
+{
+	return level <= detail::level_flag().load(std::memory_order_relaxed)
+		&& (mask & detail::category_flags().load(std::memory_order_relaxed)) != 0;
+}
+
+class trace_span
+	: noncopyable
+{
+public:
+	trace_span(const char* cat, const char* name)
+		: _ring(detail::thread_ring()), _category(cat), _name(name)
+	{
+		_ring.push('B', _category, _name);
+	}
+
+	~trace_span()
+	{
+		_ring.push('E', _category, _name);
+	}
+
+private:
+	detail::ring& _ring;
+	const char* _category;
+	const char* _name;
+};
+
+inline void export_chrome_json(std::ostream& os)
+{
+	os << "{\"traceEvents\":[";
+	bool first = true;
+	for (detail::ring* r = detail::ring_list().load(std::memory_order_acquire); r; r = r->next)
+	{
+		const uint64_t end = r->head.load(std::memory_order_acquire);
+		uint64_t begin = end > detail::ring::capacity ? end - detail::ring::capacity : 0;
+		for (uint64_t i = begin; i < end; ++i)
+		{
+			const detail::event& e = r->events[i & (detail::ring::capacity - 1)];
+			const uint64_t sequence = e.sequence.load(std::memory_order_acquire);
+			if (sequence != 2 * i + 2)
+				continue;
+			const char* name = e.name.load(std::memory_order_relaxed);
+			const char* cat = e.category.load(std::memory_order_relaxed);
+			const uint64_t ts = e.timestamp.load(std::memory_order_relaxed);
+			const char phase = e.phase.load(std::memory_order_relaxed);
+
+			// The writer may have started reusing the slot while we were reading it.
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (e.sequence.load(std::memory_order_relaxed) != sequence)
+				continue;
+
+			if (!first)
+				os << ',';
+			first = false;
+			os << "{\"name\":";
+			detail::write_json_string(os, name);
+			os << ",\"cat\":";
+			detail::write_json_string(os, cat);
+			os << ",\"ph\":\"" << phase << "\",\"ts\":" << ts / 1000 << '.';
+			const uint64_t frac = ts % 1000;
+			os << char('0' + frac / 100) << char('0' + frac / 10 % 10) << char('0' + frac % 10);
+			os << ",\"pid\":1,\"tid\":" << r->thread_id << '}';
+		}
+	}
+	os << "]}\n";
+}
+
+}
+}
+
+#define BOOST_TRACE_SPAN(level, cat, span_name) \
+	typedef ::boost::tracing::trace_span boost_trace_span; \
+	BOOST_PREDICATED_ANONYMOUS_CONSTRUCTOR(::boost::tracing::enabled(level, (cat).mask), boost_trace_span, ((cat).name, span_name))